@@ -0,0 +1,421 @@
+#pragma once
+
+#include "TwoWay.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Readers announce themselves with a plain store that has to be ordered before their next
+// loads. Where membarrier() exists the reader only needs a compiler barrier and the rare
+// synchronize() makes every running thread execute the full fence instead.
+inline const bool ASYMMETRIC_FENCE = [] {
+#if defined(__linux__)
+    return syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+#else
+    return false;
+#endif
+}();
+
+inline void reader_fence() {
+    if (ASYMMETRIC_FENCE) {
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline void writer_fence() {
+#if defined(__linux__)
+    if (ASYMMETRIC_FENCE) {
+        syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+        return;
+    }
+#endif
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// Gives every thread that uses a ConcurrentTwoWay its own index below capacity(), so epoch pins
+// are never shared. The index is handed back when the thread exits. capacity() is sized from the
+// hardware threads at startup; a thread that still finds every index taken gets SHARED for its
+// whole life and pins through a contended counter instead (see ConcurrentTwoWay::Guard).
+struct ReaderSlot {
+    static constexpr uint64_t SHARED = ~uint64_t{0};
+
+    ReaderSlot() {
+        for (uint64_t i = 0; i < capacity(); i++) {
+            bool expected = false;
+            if (taken()[i].compare_exchange_strong(expected, true)) {
+                index = i;
+                return;
+            }
+        }
+    }
+    ~ReaderSlot() {
+        if (index != SHARED)
+            taken()[index].store(false, std::memory_order_release);
+    }
+    ReaderSlot(const ReaderSlot&) = delete;
+    ReaderSlot& operator=(const ReaderSlot&) = delete;
+
+    // Twice the hardware threads, at least 128.
+    static uint64_t capacity() {
+        static const uint64_t count =
+            std::max<uint64_t>(128, 2 * uint64_t{std::thread::hardware_concurrency()});
+        return count;
+    }
+
+    static std::atomic<bool>* taken() {
+        static const std::unique_ptr<std::atomic<bool>[]> slots{
+            new std::atomic<bool>[capacity()]{}};
+        return slots.get();
+    }
+
+    static uint64_t current() {
+        thread_local ReaderSlot slot;
+        return slot.index;
+    }
+
+    uint64_t index = SHARED;
+};
+
+// TwoWay for many reader threads and a few writers.
+//
+// Every bucket has one meta word: its occupancy mask in the low 32 bits and a version in the
+// high 32 that doubles as a lock. Writers lock a bucket by making the version odd, write, and
+// make it even again. Readers take no lock, they probe both buckets and retry if either meta
+// word was locked or changed meanwhile (a seqlock). The bucket reads themselves are plain loads
+// and may see torn data, which the version check then throws away.
+//
+// grow() freezes the table so writers wait, rehashes into a new one while readers keep probing
+// the old one, publishes it and frees the old table once every reader that could still see it
+// has left (epoch-based reclamation, see Guard).
+//
+// Unlike TwoWay there are no tags, stash, cuckoo moves or incremental migration: an insert that
+// finds both buckets full grows the table.
+template <
+    TableTrait TableTrait,
+    uint64_t BUCKET = LINE_BUCKET<typename TableTrait::Key>,
+    typename Layout = layout::Split>
+struct ConcurrentTwoWay {
+    using Key = typename TableTrait::Key;
+    using Value = typename TableTrait::Value;
+    using Buckets = typename Layout::template Buckets<Key, Value, BUCKET>;
+
+    static_assert(BUCKET <= 32, "the occupancy mask shares a word with the version");
+    static constexpr uint64_t FULL = (uint64_t{1} << BUCKET) - 1;
+    // Lowest version bit, set while a writer holds the bucket.
+    static constexpr uint64_t LOCKED = uint64_t{1} << 32;
+
+    // Epoch + 1 while the owning thread holds a Guard, 0 otherwise.
+    struct alignas(CACHE_LINE) ReaderPin {
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    struct Table {
+        explicit Table(uint64_t bucket_count)
+            : capacity(bucket_count), meta(new std::atomic<uint64_t>[bucket_count]{}) {
+            buckets.allocate(capacity);
+        }
+        ~Table() {
+            buckets.release();
+            delete[] meta;
+        }
+
+        uint64_t occupied(uint64_t index) const {
+            return meta[index].load(std::memory_order_relaxed) & FULL;
+        }
+
+        // Only while holding the bucket, or before the table is published.
+        void set_occupied(uint64_t index, uint64_t mask) {
+            uint64_t word = meta[index].load(std::memory_order_relaxed);
+            meta[index].store((word & ~FULL) | mask, std::memory_order_relaxed);
+        }
+
+        void place(uint64_t index, uint64_t lane, Key key, Value value) {
+            buckets.key(index, lane) = key;
+            buckets.value(index, lane) = value;
+            set_occupied(index, occupied(index) | (uint64_t{1} << lane));
+        }
+
+        Buckets buckets;
+        uint64_t capacity;
+        std::atomic<uint64_t>* meta;
+        // Set by grow(), writers that see it back off until the new table is published.
+        std::atomic<bool> frozen{false};
+    };
+
+    // Keeps every table this thread can reach alive. A reader pins the current epoch in its own
+    // slot; synchronize() bumps the epoch and waits until no slot is pinned to an older one,
+    // after which nobody can still hold a table replaced before the bump.
+    //
+    // Threads without a slot of their own count themselves into shared[epoch & 1] instead.
+    // synchronize() calls are serialized by grow_mutex, so once the epoch moved on only readers
+    // of the previous epoch are left on its parity and the counter drains.
+    struct Guard {
+        explicit Guard(ConcurrentTwoWay& map) {
+            uint64_t slot = ReaderSlot::current();
+            for (;;) {
+                uint64_t epoch = map.epoch.load(std::memory_order_relaxed);
+                if (slot != ReaderSlot::SHARED) {
+                    pin = &map.readers[slot].epoch;
+                    pin->store(epoch + 1, std::memory_order_relaxed);
+                } else {
+                    pin = &map.shared[epoch & 1];
+                    pin->fetch_add(1, std::memory_order_relaxed);
+                }
+                reader_fence();
+                if (map.epoch.load(std::memory_order_relaxed) == epoch)
+                    break;
+                if (slot == ReaderSlot::SHARED)
+                    pin->fetch_sub(1, std::memory_order_release);
+            }
+            counted = slot == ReaderSlot::SHARED;
+        }
+        ~Guard() {
+            if (counted) {
+                pin->fetch_sub(1, std::memory_order_release);
+            } else {
+                pin->store(0, std::memory_order_release);
+            }
+        }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        std::atomic<uint64_t>* pin = nullptr;
+        bool counted = false;
+    };
+
+    // Both buckets of a pair, locked in index order.
+    struct BucketLock {
+        BucketLock(Table& table, uint64_t a, uint64_t b)
+            : meta(table.meta), first(std::min(a, b)), second(std::max(a, b)) {
+            lock(meta[first]);
+            if (second != first)
+                lock(meta[second]);
+        }
+        ~BucketLock() {
+            if (second != first)
+                unlock(meta[second]);
+            unlock(meta[first]);
+        }
+        BucketLock(const BucketLock&) = delete;
+        BucketLock& operator=(const BucketLock&) = delete;
+
+        std::atomic<uint64_t>* meta;
+        uint64_t first;
+        uint64_t second;
+    };
+
+    ConcurrentTwoWay() : current(new Table(8)) {}
+    ~ConcurrentTwoWay() {
+        delete current.load();
+    }
+    ConcurrentTwoWay(const ConcurrentTwoWay&) = delete;
+    ConcurrentTwoWay& operator=(const ConcurrentTwoWay&) = delete;
+
+    // false if `key` was already present.
+    bool insert(Key key, Value value) {
+        uint64_t hash = TableTrait::hash(key);
+        for (;;) {
+            Table* full = nullptr;
+            {
+                Guard guard{*this};
+                Table& table = *current.load(std::memory_order_acquire);
+                uint64_t index_1 = hash & (table.capacity - 1);
+                uint64_t index_2 = (hash >> 32) & (table.capacity - 1);
+                BucketLock lock{table, index_1, index_2};
+                if (!table.frozen.load()) {
+                    if (key_mask(table, index_1, key) | key_mask(table, index_2, key))
+                        return false;
+                    uint64_t free_1 = ~table.occupied(index_1) & FULL;
+                    uint64_t free_2 = ~table.occupied(index_2) & FULL;
+                    if (free_1 | free_2) {
+                        if (std::popcount(free_1) >= std::popcount(free_2)) {
+                            table.place(index_1, simd::first<BUCKET>(free_1), key, value);
+                        } else {
+                            table.place(index_2, simd::first<BUCKET>(free_2), key, value);
+                        }
+                        size_.fetch_add(1, std::memory_order_relaxed);
+                        return true;
+                    }
+                    full = &table;
+                }
+            }
+            // Outside the guard, grow() waits for every guard to leave.
+            if (full) {
+                grow(full);
+            } else {
+                wait_for_grow();
+            }
+        }
+    }
+
+    std::optional<Value> find(Key key) {
+        Guard guard{*this};
+        Table& table = *current.load(std::memory_order_acquire);
+        uint64_t hash = TableTrait::hash(key);
+        uint64_t index_1 = hash & (table.capacity - 1);
+        uint64_t index_2 = (hash >> 32) & (table.capacity - 1);
+        for (;;) {
+            uint64_t meta_1 = table.meta[index_1].load(std::memory_order_acquire);
+            uint64_t meta_2 = table.meta[index_2].load(std::memory_order_acquire);
+            if ((meta_1 | meta_2) & LOCKED) {
+                std::this_thread::yield();
+                continue;
+            }
+            uint64_t m_1 = table.buckets.match(index_1, key) & meta_1 & FULL;
+            uint64_t m_2 = table.buckets.match(index_2, key) & meta_2 & FULL;
+            std::optional<Value> value;
+            if (m_1 | m_2)
+                value = table.buckets.value(
+                    m_1 ? index_1 : index_2, simd::first<BUCKET>(m_1 ? m_1 : m_2));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (table.meta[index_1].load(std::memory_order_relaxed) == meta_1 &&
+                table.meta[index_2].load(std::memory_order_relaxed) == meta_2)
+                return value;
+        }
+    }
+
+    bool contains(Key key) {
+        return find(key).has_value();
+    }
+
+    bool erase(Key key) {
+        uint64_t hash = TableTrait::hash(key);
+        for (;;) {
+            {
+                Guard guard{*this};
+                Table& table = *current.load(std::memory_order_acquire);
+                uint64_t index_1 = hash & (table.capacity - 1);
+                uint64_t index_2 = (hash >> 32) & (table.capacity - 1);
+                BucketLock lock{table, index_1, index_2};
+                if (!table.frozen.load()) {
+                    uint64_t m_1 = key_mask(table, index_1, key);
+                    uint64_t m_2 = key_mask(table, index_2, key);
+                    if ((m_1 | m_2) == 0)
+                        return false;
+                    uint64_t index = m_1 ? index_1 : index_2;
+                    uint64_t lane = simd::first<BUCKET>(m_1 ? m_1 : m_2);
+                    table.set_occupied(index, table.occupied(index) & ~(uint64_t{1} << lane));
+                    size_.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+            wait_for_grow();
+        }
+    }
+
+    // Replaces `full` by a table at least twice its size. Writers are held off for the whole
+    // rehash, readers are not.
+    void grow(Table* full) {
+        std::lock_guard lock{grow_mutex};
+        Table* old = current.load();
+        if (old != full)
+            return;
+        old->frozen.store(true);
+        // Writers that locked a bucket before the freeze finish before we read it.
+        for (uint64_t i = 0; i < old->capacity; i++) {
+            BucketLock drain{*old, i, i};
+        }
+        Table* next = nullptr;
+        for (uint64_t capacity = old->capacity * 2; next == nullptr; capacity *= 2)
+            next = rehash(*old, capacity);
+        current.store(next);
+        synchronize();
+        delete old;
+    }
+
+    // Waits until every Guard that existed when this was called is gone.
+    void synchronize() {
+        uint64_t previous = epoch.fetch_add(1);
+        writer_fence();
+        for (uint64_t i = 0; i < ReaderSlot::capacity(); i++) {
+            for (uint64_t pin = readers[i].epoch.load(); pin != 0 && pin <= previous + 1;
+                 pin = readers[i].epoch.load())
+                std::this_thread::yield();
+        }
+        while (shared[previous & 1].load() != 0)
+            std::this_thread::yield();
+    }
+
+    uint64_t size() {
+        return size_.load(std::memory_order_relaxed);
+    }
+
+    double load_factor() {
+        return static_cast<double>(size()) /
+               static_cast<double>(current.load()->capacity * BUCKET);
+    }
+
+    uint64_t memory_usage() {
+        Table* table = current.load();
+        return (Buckets::BYTES_PER_BUCKET + sizeof(uint64_t)) * table->capacity + sizeof(Table) +
+               sizeof(ReaderPin) * ReaderSlot::capacity() + sizeof(ConcurrentTwoWay);
+    }
+
+    void wait_for_grow() {
+        std::lock_guard lock{grow_mutex};
+    }
+
+    static uint64_t key_mask(Table& table, uint64_t index, Key key) {
+        return table.buckets.match(index, key) & table.occupied(index);
+    }
+
+    // nullptr if some bucket pair overflows at `capacity`.
+    static Table* rehash(Table& old, uint64_t capacity) {
+        auto* table = new Table(capacity);
+        for (uint64_t i = 0; i < old.capacity; i++) {
+            for (uint64_t mask = old.occupied(i); mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                Key key = old.buckets.key(i, lane);
+                uint64_t hash = TableTrait::hash(key);
+                uint64_t index_1 = hash & (capacity - 1);
+                uint64_t index_2 = (hash >> 32) & (capacity - 1);
+                uint64_t free_1 = ~table->occupied(index_1) & FULL;
+                uint64_t free_2 = ~table->occupied(index_2) & FULL;
+                if ((free_1 | free_2) == 0) {
+                    delete table;
+                    return nullptr;
+                }
+                uint64_t index = std::popcount(free_1) >= std::popcount(free_2) ? index_1 : index_2;
+                uint64_t free = index == index_1 ? free_1 : free_2;
+                table->place(index, simd::first<BUCKET>(free), key, old.buckets.value(i, lane));
+            }
+        }
+        return table;
+    }
+
+    static void lock(std::atomic<uint64_t>& meta) {
+        for (;;) {
+            uint64_t word = meta.load(std::memory_order_relaxed);
+            if ((word & LOCKED) == 0 &&
+                meta.compare_exchange_weak(word, word + LOCKED, std::memory_order_acquire))
+                break;
+            std::this_thread::yield();
+        }
+        // Readers that see our bucket writes must also see the odd version.
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    static void unlock(std::atomic<uint64_t>& meta) {
+        meta.fetch_add(LOCKED, std::memory_order_release);
+    }
+
+    std::atomic<Table*> current;
+    std::atomic<uint64_t> size_{0};
+    std::mutex grow_mutex;
+    std::atomic<uint64_t> epoch{0};
+    std::unique_ptr<ReaderPin[]> readers{new ReaderPin[ReaderSlot::capacity()]};
+    // Guards of threads without a ReaderSlot, by epoch parity.
+    std::atomic<uint64_t> shared[2]{};
+};
@@ -0,0 +1,244 @@
+#pragma once
+
+#include "TwoWay.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <type_traits>
+
+// TwoWay for integer keys below 2^KEY_BITS that stores only part of each key. Keys go through
+// permute<KEY_BITS>, a bijection, and the top bits of the result (the quotient) pick the first
+// bucket; a lane keeps just the remainder below them plus one bit saying which choice the entry
+// took, so with u16 lanes a cache line holds 32 keys instead of 8. The second bucket is the first
+// XOR a hash of the remainder, so either bucket and the remainder give back the other and the
+// full permuted key.
+//
+// Bucket counts are powers of two and the remainder shrinks by one bit with every doubling; the
+// table starts at the fewest buckets (MIN_BUCKET_BITS) whose remainder fits a lane. There is no
+// cuckoo displacement or stash: an insert whose buckets are both full doubles the table, and a
+// rehash that cannot place every entry restarts one bit larger, up to KEY_BITS bucket bits.
+//
+// Stats works as in TwoWay; hits are only ever FIRST or SECOND.
+template <
+    typename Value,
+    // Every key must be below 2^KEY_BITS (asserted); the bits above are dropped, so a larger key
+    // would alias a smaller one.
+    uint64_t KEY_BITS,
+    typename Lane = uint16_t,
+    uint64_t BUCKET = LINE_BUCKET<Lane>,
+    typename Stats = stats::Off>
+struct QuotientTwoWay {
+    static_assert(std::is_unsigned_v<Lane> && KEY_BITS <= 64);
+    static_assert(std::is_trivially_copyable_v<Value>);
+
+    using Key = uint64_t;
+    using Mask = LaneMask<BUCKET>;
+
+    static constexpr uint64_t FULL = (uint64_t{1} << BUCKET) - 1;
+    static constexpr uint64_t LANE_BITS = 8 * sizeof(Lane);
+    static constexpr uint64_t MIN_BUCKET_BITS =
+        std::max<uint64_t>(3, KEY_BITS + 1 > LANE_BITS ? KEY_BITS + 1 - LANE_BITS : 0);
+    static_assert(MIN_BUCKET_BITS <= KEY_BITS, "no bucket count leaves a remainder this small");
+
+    struct Slot {
+        Lane lanes[BUCKET];
+        Value values[BUCKET];
+    };
+
+    QuotientTwoWay() : bucket_bits(MIN_BUCKET_BITS), capacity(1ULL << bucket_bits), size_(0) {
+        allocate();
+    }
+    ~QuotientTwoWay() {
+        __aligned_free(data);
+        __aligned_free(occupied);
+    }
+    QuotientTwoWay(const QuotientTwoWay&) = delete;
+    QuotientTwoWay& operator=(const QuotientTwoWay&) = delete;
+
+    // assumes key is not in the map
+    void insert(Key key, Value value) {
+        assert(in_range(key));
+        put(permute<KEY_BITS>(key), value);
+        size_++;
+    }
+
+    // assumes key is in the map, see find_ptr
+    Value find(Key key) {
+        return *find_ptr(key);
+    }
+
+    // nullptr if the key is absent.
+    Value* find_ptr(Key key) {
+        assert(in_range(key));
+        const Position at = position(permute<KEY_BITS>(key));
+        uint64_t m_1 = match(at.index_1, at.lane_1);
+        uint64_t m_2 = match(at.index_2, at.lane_2);
+        if ((m_1 | m_2) == 0) {
+            probe_stats.miss();
+            return nullptr;
+        }
+        uint64_t lane = simd::first<BUCKET>(m_1 ? m_1 : m_2);
+        probe_stats.hit(m_1 ? stats::FIRST : stats::SECOND, lane, 2 * lane + (m_1 ? 0 : 1));
+        return &data[m_1 ? at.index_1 : at.index_2].values[lane];
+    }
+
+    bool contains(Key key) {
+        return find_ptr(key) != nullptr;
+    }
+
+    void erase(Key key) {
+        assert(in_range(key));
+        const Position at = position(permute<KEY_BITS>(key));
+        uint64_t m_1 = match(at.index_1, at.lane_1);
+        uint64_t m_2 = match(at.index_2, at.lane_2);
+        if ((m_1 | m_2) == 0)
+            return;
+        uint64_t index = m_1 ? at.index_1 : at.index_2;
+        uint64_t lane = simd::first<BUCKET>(m_1 ? m_1 : m_2);
+        occupied[index] = static_cast<Mask>(occupied[index] & ~(uint64_t{1} << lane));
+        size_--;
+    }
+
+    void clear() {
+        size_ = 0;
+        std::memset(occupied, 0, sizeof(Mask) * capacity);
+    }
+
+    // Calls f(key, value) for every entry, in no particular order. Keys are rebuilt from their
+    // bucket and remainder through unpermute().
+    void for_each(auto&& f) {
+        for (uint64_t i = 0; i < capacity; i++) {
+            for (uint64_t mask = occupied[i]; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                Key key = unpermute<KEY_BITS>(hash_at(i, data[i].lanes[lane], bucket_bits));
+                f(key, data[i].values[lane]);
+            }
+        }
+    }
+
+    uint64_t size() {
+        return size_;
+    }
+
+    double load_factor() {
+        return static_cast<double>(size_) / static_cast<double>(capacity * BUCKET);
+    }
+
+    uint64_t memory_usage() {
+        return (sizeof(Slot) + sizeof(Mask)) * capacity + sizeof(QuotientTwoWay);
+    }
+
+    static constexpr bool in_range(Key key) {
+        return KEY_BITS == 64 || key >> (KEY_BITS % 64) == 0;
+    }
+
+    // Where a permuted key lives: both buckets and what a lane of each holds for it.
+    struct Position {
+        uint64_t index_1;
+        uint64_t index_2;
+        Lane lane_1;
+        Lane lane_2;
+    };
+
+    Position position(uint64_t hash) {
+        uint64_t remainder_bits = KEY_BITS - bucket_bits;
+        uint64_t quotient = hash >> remainder_bits;
+        uint64_t remainder = hash & ((uint64_t{1} << remainder_bits) - 1);
+        return {
+            quotient,
+            quotient ^ offset(remainder, bucket_bits),
+            static_cast<Lane>(remainder << 1),
+            static_cast<Lane>((remainder << 1) | 1),
+        };
+    }
+
+    // Distance between the two buckets of a remainder, as an XOR mask of `bits` bits.
+    static uint64_t offset(uint64_t remainder, uint64_t bits) {
+        return ((remainder + 1) * 0x9E3779B97F4A7C15ULL) >> (64 - bits);
+    }
+
+    // The permuted key held as `stored` in bucket `index` of a table with 2^bits buckets.
+    static uint64_t hash_at(uint64_t index, Lane stored, uint64_t bits) {
+        uint64_t remainder = uint64_t{stored} >> 1;
+        uint64_t quotient = (stored & 1) ? index ^ offset(remainder, bits) : index;
+        return (quotient << (KEY_BITS - bits)) | remainder;
+    }
+
+    // Occupied lanes of bucket `index` holding `stored`.
+    uint64_t match(uint64_t index, Lane stored) {
+        return simd::match<Lane, BUCKET>(data[index].lanes, stored) & occupied[index];
+    }
+
+    void put(uint64_t hash, Value value) {
+        while (!try_put(hash, value))
+            grow();
+    }
+
+    // false if both buckets are full.
+    bool try_put(uint64_t hash, Value value) {
+        const Position at = position(hash);
+        uint64_t free_1 = ~uint64_t{occupied[at.index_1]} & FULL;
+        uint64_t free_2 = ~uint64_t{occupied[at.index_2]} & FULL;
+        if ((free_1 | free_2) == 0)
+            return false;
+        bool first = std::popcount(free_1) >= std::popcount(free_2);
+        uint64_t index = first ? at.index_1 : at.index_2;
+        uint64_t lane = simd::first<BUCKET>(first ? free_1 : free_2);
+        data[index].lanes[lane] = first ? at.lane_1 : at.lane_2;
+        data[index].values[lane] = value;
+        occupied[index] = static_cast<Mask>(occupied[index] | (uint64_t{1} << lane));
+        return true;
+    }
+
+    void grow() {
+        rehash(bucket_bits + 1);
+    }
+
+    // Moves every entry into a table of 2^bits buckets, rebuilding its permuted key and splitting
+    // it further. Entries are copied out of the untouched old arrays with try_put(), which never
+    // grows; if one does not fit, the new arrays are dropped and the pass restarts one bit larger,
+    // so a rehash never cascades (as TwoWay::rehash).
+    void rehash(uint64_t bits) {
+        Slot* from = data;
+        Mask* from_occupied = occupied;
+        uint64_t from_bits = bucket_bits;
+        for (;; bits++) {
+            // The remainder is KEY_BITS - bits wide; past KEY_BITS there is nothing left to split.
+            assert(bits <= KEY_BITS && bits < 64);
+            bucket_bits = bits;
+            capacity = uint64_t{1} << bits;
+            allocate();
+            if (rehash_from(from, from_occupied, from_bits))
+                break;
+            __aligned_free(data);
+            __aligned_free(occupied);
+        }
+        __aligned_free(from);
+        __aligned_free(from_occupied);
+    }
+
+    bool rehash_from(const Slot* from, const Mask* from_occupied, uint64_t from_bits) {
+        for (uint64_t i = 0; i < (uint64_t{1} << from_bits); i++) {
+            for (uint64_t mask = from_occupied[i]; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                if (!try_put(hash_at(i, from[i].lanes[lane], from_bits), from[i].values[lane]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void allocate() {
+        data = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * capacity));
+        occupied = reinterpret_cast<Mask*>(__aligned_alloc(CACHE_LINE, sizeof(Mask) * capacity));
+        std::memset(occupied, 0, sizeof(Mask) * capacity);
+    }
+
+    Slot* data;
+    Mask* occupied;
+    uint64_t bucket_bits;
+    uint64_t capacity;
+    uint64_t size_;
+    [[no_unique_address]] Stats probe_stats;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "TwoWay.hpp"
+
+#include <array>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+// SHARDS independent TwoWays, each behind its own mutex on its own cache line. Keys are routed
+// by their lowest hash bits, which TwoWay's multiply-high bucket indexes barely depend on, so
+// writers on different shards never touch the same lock or memory.
+// The batch entry points sort a batch by shard first and take every lock once per batch.
+template <
+    TableTrait TableTrait,
+    uint64_t BUCKET = LINE_BUCKET<typename TableTrait::Key>,
+    uint64_t SHARDS = 64>
+struct ShardedTwoWay {
+    using Key = typename TableTrait::Key;
+    using Value = typename TableTrait::Value;
+    using Map = TwoWay<TableTrait, BUCKET>;
+
+    static_assert(std::has_single_bit(SHARDS) && SHARDS > 1);
+
+    struct alignas(CACHE_LINE) Shard {
+        std::mutex mutex;
+        Map map;
+    };
+
+    static uint64_t shard_of(Key key) {
+        return TableTrait::hash(key) & (SHARDS - 1);
+    }
+
+    // assumes key is not in the map
+    void insert(Key key, Value value) {
+        Shard& shard = shards[shard_of(key)];
+        std::lock_guard lock{shard.mutex};
+        shard.map.insert(key, value);
+    }
+
+    std::optional<Value> find(Key key) {
+        Shard& shard = shards[shard_of(key)];
+        std::lock_guard lock{shard.mutex};
+        const Value* value = shard.map.find_ptr(key);
+        return value ? std::optional<Value>{*value} : std::nullopt;
+    }
+
+    bool contains(Key key) {
+        Shard& shard = shards[shard_of(key)];
+        std::lock_guard lock{shard.mutex};
+        return shard.map.contains(key);
+    }
+
+    void erase(Key key) {
+        Shard& shard = shards[shard_of(key)];
+        std::lock_guard lock{shard.mutex};
+        shard.map.erase(key);
+    }
+
+    // Inserts keys[i] -> values[i]; assumes none of the keys are in the map.
+    void insert_many(std::span<const Key> keys, std::span<const Value> values) {
+        Batch batch{keys};
+        for (uint64_t s = 0; s < SHARDS; s++) {
+            if (batch.begin[s] == batch.begin[s + 1])
+                continue;
+            std::lock_guard lock{shards[s].mutex};
+            for (uint64_t i = batch.begin[s]; i < batch.begin[s + 1]; i++)
+                shards[s].map.insert(keys[batch.order[i]], values[batch.order[i]]);
+        }
+    }
+
+    // out[i] receives the value of keys[i], or Value{} if it is absent.
+    void find_many(std::span<const Key> keys, std::span<Value> out) {
+        Batch batch{keys};
+        for (uint64_t s = 0; s < SHARDS; s++) {
+            if (batch.begin[s] == batch.begin[s + 1])
+                continue;
+            std::lock_guard lock{shards[s].mutex};
+            for (uint64_t i = batch.begin[s]; i < batch.begin[s + 1]; i++) {
+                const Value* value = shards[s].map.find_ptr(keys[batch.order[i]]);
+                out[batch.order[i]] = value ? *value : Value{};
+            }
+        }
+    }
+
+    uint64_t size() {
+        uint64_t total = 0;
+        for (auto& shard : shards) {
+            std::lock_guard lock{shard.mutex};
+            total += shard.map.size();
+        }
+        return total;
+    }
+
+    uint64_t memory_usage() {
+        uint64_t total = sizeof(ShardedTwoWay);
+        for (auto& shard : shards) {
+            std::lock_guard lock{shard.mutex};
+            total += shard.map.memory_usage() - sizeof(Map);
+        }
+        return total;
+    }
+
+    // Positions of a batch counting-sorted by shard: shard s owns order[begin[s], begin[s + 1]).
+    struct Batch {
+        explicit Batch(std::span<const Key> keys) : order(keys.size()) {
+            std::vector<uint32_t> shard(keys.size());
+            begin.fill(0);
+            for (uint64_t i = 0; i < keys.size(); i++) {
+                shard[i] = static_cast<uint32_t>(shard_of(keys[i]));
+                begin[shard[i] + 1]++;
+            }
+            for (uint64_t s = 0; s < SHARDS; s++)
+                begin[s + 1] += begin[s];
+            std::array<uint64_t, SHARDS> next{};
+            std::copy_n(begin.begin(), SHARDS, next.begin());
+            for (uint64_t i = 0; i < keys.size(); i++)
+                order[next[shard[i]]++] = i;
+        }
+
+        std::vector<uint64_t> order;
+        std::array<uint64_t, SHARDS + 1> begin;
+    };
+
+    std::array<Shard, SHARDS> shards{};
+};
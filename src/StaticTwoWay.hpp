@@ -0,0 +1,163 @@
+#pragma once
+
+#include "TwoWay.hpp"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <utility>
+
+// TwoWay for key sets fixed at build time. make_static_two_way() runs entirely in the compiler:
+// it sizes the table for the entry count the way reserve() would, places every entry as
+// insert() does (emptier bucket first, random-walk cuckoo moves when both are full) and returns
+// the finished image. Stored in a constexpr variable it lands in .rodata, so nothing runs at
+// startup and every process mapping the binary shares its pages; constinit keeps it writable.
+//
+// Buckets are indexed with TwoWay's bucket_1/bucket_2 over TableTrait::hash, which has to be
+// constexpr and may be chosen for the known keys. A duplicate key or entries that do not fit
+// fail to compile; pass more BUCKETS or a wider BUCKET for the latter. There is no stash.
+template <TableTrait TableTrait, uint64_t BUCKET, uint64_t BUCKETS>
+struct StaticTwoWay {
+    using Key = typename TableTrait::Key;
+    using Value = typename TableTrait::Value;
+    using Mask = LaneMask<BUCKET>;
+    using Indexing = TwoWay<TableTrait, BUCKET>;
+
+    static constexpr uint64_t FULL = (uint64_t{1} << BUCKET) - 1;
+    // Cuckoo moves tried for one entry before the build gives up.
+    static constexpr uint64_t MAX_KICKS = 512;
+
+    struct Slot {
+        Key keys[BUCKET];
+        Value values[BUCKET];
+    };
+
+    // assumes key is in the map, see find_ptr
+    constexpr Value find(Key key) const {
+        return *find_ptr(key);
+    }
+
+    // nullptr if the key is absent.
+    constexpr const Value* find_ptr(Key key) const {
+        uint64_t hash = TableTrait::hash(key);
+        uint64_t index_1 = Indexing::bucket_1(hash, BUCKETS);
+        uint64_t index_2 = Indexing::bucket_2(hash, BUCKETS);
+        uint64_t m_1 = match(index_1, key);
+        uint64_t m_2 = match(index_2, key);
+        if ((m_1 | m_2) == 0)
+            return nullptr;
+        uint64_t lane = static_cast<uint64_t>(std::countr_zero(m_1 ? m_1 : m_2));
+        return &slots[m_1 ? index_1 : index_2].values[lane];
+    }
+
+    constexpr bool contains(Key key) const {
+        return find_ptr(key) != nullptr;
+    }
+
+    constexpr uint64_t size() const {
+        return size_;
+    }
+
+    constexpr double load_factor() const {
+        return static_cast<double>(size_) / static_cast<double>(BUCKETS * BUCKET);
+    }
+
+    constexpr uint64_t memory_usage() const {
+        return sizeof(StaticTwoWay);
+    }
+
+    // Occupied lanes of bucket `index` holding `key`; the vector kernels only run outside
+    // constant evaluation.
+    constexpr uint64_t match(uint64_t index, Key key) const {
+        if consteval {
+            uint64_t mask = 0;
+            for (uint64_t i = 0; i < BUCKET; i++)
+                mask |= static_cast<uint64_t>(slots[index].keys[i] == key) << i;
+            return mask & occupied[index];
+        } else {
+            return simd::match<Key, BUCKET>(slots[index].keys, key) & occupied[index];
+        }
+    }
+
+    // insert() without growing or stashing: false if MAX_KICKS cuckoo moves found no room.
+    constexpr bool put(Key key, Value value, uint64_t& rng) {
+        uint64_t hash = TableTrait::hash(key);
+        uint64_t index_1 = Indexing::bucket_1(hash, BUCKETS);
+        uint64_t index_2 = Indexing::bucket_2(hash, BUCKETS);
+        uint64_t free_1 = ~uint64_t{occupied[index_1]} & FULL;
+        uint64_t free_2 = ~uint64_t{occupied[index_2]} & FULL;
+        if (free_1 | free_2) {
+            bool first = std::popcount(free_1) >= std::popcount(free_2);
+            place(first ? index_1 : index_2, first ? free_1 : free_2, key, value);
+            return true;
+        }
+        uint64_t index = next_random(rng) & 1 ? index_1 : index_2;
+        for (uint64_t kick = 0; kick < MAX_KICKS; kick++) {
+            uint64_t lane = next_random(rng) % BUCKET;
+            std::swap(key, slots[index].keys[lane]);
+            std::swap(value, slots[index].values[lane]);
+            hash = TableTrait::hash(key);
+            uint64_t alt_1 = Indexing::bucket_1(hash, BUCKETS);
+            index = index == alt_1 ? Indexing::bucket_2(hash, BUCKETS) : alt_1;
+            uint64_t free = ~uint64_t{occupied[index]} & FULL;
+            if (free) {
+                place(index, free, key, value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stores the entry in the first lane set in `free`.
+    constexpr void place(uint64_t index, uint64_t free, Key key, Value value) {
+        uint64_t lane = static_cast<uint64_t>(std::countr_zero(free));
+        slots[index].keys[lane] = key;
+        slots[index].values[lane] = value;
+        occupied[index] = static_cast<Mask>(occupied[index] | (uint64_t{1} << lane));
+        size_++;
+    }
+
+    static constexpr uint64_t next_random(uint64_t& rng) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    }
+
+    alignas(CACHE_LINE) Slot slots[BUCKETS]{};
+    Mask occupied[BUCKETS]{};
+    uint64_t size_ = 0;
+};
+
+// Buckets for `entries` entries at TwoWay's RESERVE_LOAD, as reserve() picks them.
+template <TableTrait TableTrait, uint64_t BUCKET>
+consteval uint64_t static_buckets(uint64_t entries) {
+    const double exact =
+        static_cast<double>(entries) / (TwoWay<TableTrait, BUCKET>::RESERVE_LOAD * BUCKET);
+    auto buckets = static_cast<uint64_t>(exact);
+    if (static_cast<double>(buckets) < exact)
+        buckets++;
+    return std::max<uint64_t>(buckets, 1);
+}
+
+// Builds a StaticTwoWay image of `entries` at compile time, with BUCKETS buckets or, if 0, as
+// many as static_buckets() asks for.
+template <
+    TableTrait TableTrait,
+    uint64_t BUCKET = LINE_BUCKET<typename TableTrait::Key>,
+    uint64_t BUCKETS = 0,
+    size_t N>
+consteval auto make_static_two_way(
+    const std::array<std::pair<typename TableTrait::Key, typename TableTrait::Value>, N>&
+        entries) {
+    constexpr uint64_t COUNT = BUCKETS ? BUCKETS : static_buckets<TableTrait, BUCKET>(N);
+    StaticTwoWay<TableTrait, BUCKET, COUNT> table{};
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (const auto& [key, value] : entries) {
+        if (table.contains(key))
+            throw "make_static_two_way: duplicate key";
+        if (!table.put(key, value, rng))
+            throw "make_static_two_way: entries do not fit, raise BUCKETS";
+    }
+    return table;
+}
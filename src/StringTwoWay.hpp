@@ -0,0 +1,214 @@
+#pragma once
+
+#include "TwoWay.hpp"
+#include "stats.hpp"
+
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+template <typename T>
+concept StringTableTrait =
+    requires {
+        typename T::Value;
+
+        { T::hash(std::declval<std::string_view>()) } -> std::convertible_to<uint64_t>;
+    } && std::is_trivially_copyable_v<typename T::Value>;
+
+// TwoWay for variable-length keys. Each lane stores the key's full 64-bit hash and an
+// offset/length handle into one contiguous arena holding the key bytes. Probes compare hashes
+// with one vector compare per bucket and only look at the bytes of lanes whose hash matched.
+//
+// Growing reuses the stored hashes, keys are never rehashed or moved. Erased keys keep their
+// arena bytes until clear(). Handles are 32 bits, so insert() throws std::length_error once the
+// arena would pass 4 GiB of key bytes.
+//
+// Stats works as in TwoWay; there is no stash, so hits are only ever FIRST or SECOND.
+template <
+    StringTableTrait TableTrait,
+    uint64_t BUCKET = LINE_BUCKET<uint64_t>,
+    typename Stats = stats::Off>
+struct StringTwoWay {
+    using Value = typename TableTrait::Value;
+    using Mask = LaneMask<BUCKET>;
+
+    static constexpr uint64_t FULL = (uint64_t{1} << BUCKET) - 1;
+
+    struct Slot {
+        uint64_t hashes[BUCKET];
+        uint32_t offsets[BUCKET];
+        uint32_t lengths[BUCKET];
+        Value values[BUCKET];
+    };
+
+    StringTwoWay() : capacity(8), size_(0) {
+        allocate();
+    }
+    ~StringTwoWay() {
+        __aligned_free(data);
+        __aligned_free(occupied);
+    }
+    StringTwoWay(const StringTwoWay&) = delete;
+    StringTwoWay& operator=(const StringTwoWay&) = delete;
+
+    // assumes key is not in the map
+    void insert(std::string_view key, Value value) {
+        if (key.size() > std::numeric_limits<uint32_t>::max() - arena.size())
+            throw std::length_error("StringTwoWay: arena exceeds 4 GiB of key bytes");
+        uint64_t offset = arena.size();
+        arena.insert(arena.end(), key.begin(), key.end());
+        put(TableTrait::hash(key),
+            static_cast<uint32_t>(offset),
+            static_cast<uint32_t>(key.size()),
+            value);
+        size_++;
+    }
+
+    // assumes key is in the map, see find_ptr
+    Value find(std::string_view key) {
+        return *find_ptr(key);
+    }
+
+    // nullptr if the key is absent.
+    Value* find_ptr(std::string_view key) {
+        uint64_t hash = TableTrait::hash(key);
+        uint64_t index_1 = hash & (capacity - 1);
+        uint64_t index_2 = (hash >> 32) & (capacity - 1);
+        uint64_t index = index_1;
+        uint64_t lane = match(index_1, hash, key);
+        if (lane == BUCKET) {
+            index = index_2;
+            lane = match(index_2, hash, key);
+        }
+        if (lane == BUCKET) {
+            probe_stats.miss();
+            return nullptr;
+        }
+        bool first = index == index_1;
+        probe_stats.hit(first ? stats::FIRST : stats::SECOND, lane, 2 * lane + (first ? 0 : 1));
+        return &data[index].values[lane];
+    }
+
+    bool contains(std::string_view key) {
+        return find_ptr(key) != nullptr;
+    }
+
+    void erase(std::string_view key) {
+        uint64_t hash = TableTrait::hash(key);
+        for (uint64_t index : {hash & (capacity - 1), (hash >> 32) & (capacity - 1)}) {
+            uint64_t lane = match(index, hash, key);
+            if (lane < BUCKET) {
+                occupied[index] = static_cast<Mask>(occupied[index] & ~(uint64_t{1} << lane));
+                size_--;
+                return;
+            }
+        }
+    }
+
+    void clear() {
+        size_ = 0;
+        arena.clear();
+        std::memset(occupied, 0, sizeof(Mask) * capacity);
+    }
+
+    uint64_t size() {
+        return size_;
+    }
+
+    double load_factor() {
+        return static_cast<double>(size_) / static_cast<double>(capacity * BUCKET);
+    }
+
+    uint64_t memory_usage() {
+        return (sizeof(Slot) + sizeof(Mask)) * capacity + arena.capacity() + sizeof(StringTwoWay);
+    }
+
+    // Lane of bucket `index` holding `key`, or BUCKET.
+    uint64_t match(uint64_t index, uint64_t hash, std::string_view key) {
+        const Slot& slot = data[index];
+        uint64_t candidates = simd::match<uint64_t, BUCKET>(slot.hashes, hash) & occupied[index];
+        for (; candidates; candidates &= candidates - 1) {
+            uint64_t lane = static_cast<uint64_t>(std::countr_zero(candidates));
+            if (slot.lengths[lane] == key.size() &&
+                (key.empty() ||
+                 std::memcmp(arena.data() + slot.offsets[lane], key.data(), key.size()) == 0))
+                return lane;
+        }
+        return BUCKET;
+    }
+
+    void put(uint64_t hash, uint32_t offset, uint32_t length, Value value) {
+        while (!try_put(hash, offset, length, value))
+            grow();
+    }
+
+    // false if both buckets are full.
+    bool try_put(uint64_t hash, uint32_t offset, uint32_t length, Value value) {
+        uint64_t index_1 = hash & (capacity - 1);
+        uint64_t index_2 = (hash >> 32) & (capacity - 1);
+        uint64_t free_1 = ~uint64_t{occupied[index_1]} & FULL;
+        uint64_t free_2 = ~uint64_t{occupied[index_2]} & FULL;
+        if ((free_1 | free_2) == 0)
+            return false;
+        bool first = std::popcount(free_1) >= std::popcount(free_2);
+        uint64_t index = first ? index_1 : index_2;
+        uint64_t lane = simd::first<BUCKET>(first ? free_1 : free_2);
+        Slot& slot = data[index];
+        slot.hashes[lane] = hash;
+        slot.offsets[lane] = offset;
+        slot.lengths[lane] = length;
+        slot.values[lane] = value;
+        occupied[index] = static_cast<Mask>(occupied[index] | (uint64_t{1} << lane));
+        return true;
+    }
+
+    void grow() {
+        rehash(capacity * 2);
+    }
+
+    // Copies the entries out of the untouched old arrays with try_put(), which never grows; if one
+    // does not fit, the new arrays are dropped and the pass restarts twice as large, so a rehash
+    // never cascades (as TwoWay::rehash).
+    void rehash(uint64_t buckets) {
+        Slot* from = data;
+        Mask* from_occupied = occupied;
+        uint64_t from_capacity = capacity;
+        for (;; buckets *= 2) {
+            capacity = buckets;
+            allocate();
+            if (rehash_from(from, from_occupied, from_capacity))
+                break;
+            __aligned_free(data);
+            __aligned_free(occupied);
+        }
+        __aligned_free(from);
+        __aligned_free(from_occupied);
+    }
+
+    bool rehash_from(const Slot* from, const Mask* from_occupied, uint64_t from_capacity) {
+        for (uint64_t i = 0; i < from_capacity; i++) {
+            for (uint64_t mask = from_occupied[i]; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                const Slot& slot = from[i];
+                if (!try_put(slot.hashes[lane], slot.offsets[lane], slot.lengths[lane],
+                             slot.values[lane]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    void allocate() {
+        data = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * capacity));
+        occupied = reinterpret_cast<Mask*>(__aligned_alloc(CACHE_LINE, sizeof(Mask) * capacity));
+        std::memset(occupied, 0, sizeof(Mask) * capacity);
+    }
+
+    Slot* data;
+    Mask* occupied;
+    uint64_t capacity;
+    uint64_t size_;
+    std::vector<char> arena;
+    [[no_unique_address]] Stats probe_stats;
+};
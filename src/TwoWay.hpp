@@ -1,12 +1,23 @@
 #pragma once
 
 #include "base.hpp"
+#include "layout.hpp"
+#include "simd.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
 
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cmath>
 #include <concepts>
-#include <limits>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <thread>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 template <typename T>
 concept TableTrait =
@@ -18,130 +29,638 @@ concept TableTrait =
     } && std::is_trivially_copyable_v<typename T::Key> &&
     std::is_trivially_copyable_v<typename T::Value>;
 
-template <TableTrait TableTrait, uint64_t BUCKET>
+// Lanes per bucket for which one bucket's keys fill exactly one cache line, capped so lane masks
+// still fit in 64 bits.
+template <typename Key>
+inline constexpr uint64_t LINE_BUCKET = std::min<uint64_t>(CACHE_LINE / sizeof(Key), 32);
+
+// Smallest unsigned type with one bit per lane.
+template <uint64_t LANES>
+using LaneMask = std::conditional_t<
+    LANES <= 8,
+    uint8_t,
+    std::conditional_t<LANES <= 16, uint16_t, std::conditional_t<LANES <= 32, uint32_t, uint64_t>>>;
+
+// Every bucket has an occupancy mask with one bit per lane, so every key value is storable and
+// lanes without their bit set are never read as entries.
+//
+// With TAGS, every bucket also gets BUCKET one-byte tags (8 hash bits) in a separate array.
+// Probes filter on the tags and only load keys whose tag matched.
+//
+// Layout picks how keys and values sit in memory, see layout.hpp.
+//
+// Bucket indexes come from a multiply-high of each 32-bit hash half rather than a mask, so the
+// bucket count is not tied to powers of two: grow() scales it by `growth` and reserve() sizes the
+// table for an exact entry count.
+//
+// With migrate_step > 0, grow() only allocates the new arrays; the old generation is kept and
+// every insert/find moves migrate_step old buckets over until it is empty. Lookups check both
+// generations meanwhile, so no single call pays for the whole rehash.
+//
+// Entries that find no room even after cuckoo displacement go to a small stash searched with
+// one vector compare; the table only grows once the stash is full.
+//
+// save() writes the table to a snapshot file (see snapshot.hpp) that open_mapped() maps back
+// read-only, so a large table can serve lookups right after startup without being rebuilt.
+//
+// Stats picks what lookups record about themselves (see stats.hpp) into `probe_stats`; the
+// default stats::Off records nothing and costs nothing.
+template <
+    TableTrait TableTrait,
+    uint64_t BUCKET = LINE_BUCKET<typename TableTrait::Key>,
+    bool TAGS = false,
+    typename Layout = layout::Split,
+    typename Stats = stats::Off>
 struct TwoWay {
     using Key = typename TableTrait::Key;
     using Value = typename TableTrait::Value;
+    using Buckets = typename Layout::template Buckets<Key, Value, BUCKET>;
+    using Mask = LaneMask<BUCKET>;
 
-    static constexpr Key EMPTY = std::numeric_limits<Key>::max();
+    static constexpr uint64_t BUCKET_LANES = BUCKET;
+    static constexpr uint64_t FULL = (uint64_t{1} << BUCKET) - 1;
+    static constexpr uint64_t STASH = 8;
+    // Load reserve() plans for; two-choice buckets of 4+ lanes hold well above this before the
+    // first insert has to grow, narrower ones do not.
+    static constexpr double RESERVE_LOAD = BUCKET >= 4 ? 0.9 : 0.5;
 
     TwoWay() : capacity(8), size_(0) {
-        data = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * capacity));
-        fill_empty(data, capacity);
+        allocate();
+    }
+    // Starts out with `buckets` buckets, at least 8.
+    explicit TwoWay(uint64_t buckets) : capacity(std::max<uint64_t>(buckets, 8)), size_(0) {
+        allocate();
+    }
+    // Bulk load: sized once for all entries (as reserve()), then every key is hashed up front and
+    // the entries are placed in order of their first bucket, so the stores walk the arrays front
+    // to back instead of jumping around. Assumes no key appears twice.
+    explicit TwoWay(std::span<const std::pair<Key, Value>> entries)
+        : TwoWay(buckets_for(entries.size())) {
+        std::vector<uint64_t> hashes(entries.size());
+        std::vector<uint64_t> begin(capacity + 1, 0);
+        for (uint64_t i = 0; i < entries.size(); i++) {
+            hashes[i] = TableTrait::hash(entries[i].first);
+            begin[bucket_1(hashes[i], capacity) + 1]++;
+        }
+        for (uint64_t b = 0; b < capacity; b++)
+            begin[b + 1] += begin[b];
+        std::vector<uint64_t> order(entries.size());
+        for (uint64_t i = 0; i < entries.size(); i++)
+            order[begin[bucket_1(hashes[i], capacity)]++] = i;
+        for (const auto i : order) {
+            put(hashes[i], entries[i].first, entries[i].second);
+            size_++;
+        }
     }
     ~TwoWay() {
-        __aligned_free(data);
+        if (mapping) {
+            // Points into the mapping, which unmaps itself.
+            data = Buckets{};
+            occupied = nullptr;
+            tags = nullptr;
+        }
+        release(data, occupied, tags);
+        release(old_data, old_occupied, old_tags);
     }
 
-    // assumes key is not in the map
+    // assumes key is not in the map, see try_emplace for keys that may be present
     void insert(Key key, Value value) {
-        uint64_t hash = TableTrait::hash(key);
-        uint64_t index_1 = hash & (capacity - 1);
-        uint64_t index_2 = (hash >> 32) & (capacity - 1);
-        Slot* slot_1 = &data[index_1];
-        Slot* slot_2 = &data[index_2];
-        uint64_t n_1 = 0;
-        uint64_t n_2 = 0;
-        while (slot_1->keys[n_1] < EMPTY && ++n_1 < BUCKET)
-            ;
-        while (slot_2->keys[n_2] < EMPTY && ++n_2 < BUCKET)
-            ;
-        if (n_1 == BUCKET && n_2 == BUCKET) {
-            grow();
-            insert(key, value);
-            return;
-        }
-        if (n_1 <= n_2) {
-            slot_1->keys[n_1] = key;
-            slot_1->values[n_1] = value;
-        } else {
-            slot_2->keys[n_2] = key;
-            slot_2->values[n_2] = value;
-        }
+        if (old_data)
+            migrate(migrate_step);
+        put(key, value);
         size_++;
     }
 
-    Value find(Key key, uint64_t* steps) {
-        uint64_t hash = TableTrait::hash(key);
-        uint64_t index_1 = hash & (capacity - 1);
-        uint64_t index_2 = (hash >> 32) & (capacity - 1);
-        Slot* slot_1 = &data[index_1];
-        Slot* slot_2 = &data[index_2];
-        for (uint64_t i = 0;; i++) {
-            if (slot_1->keys[i] == key)
-                return slot_1->values[i];
-            (*steps)++;
-            if (slot_2->keys[i] == key)
-                return slot_2->values[i];
-            (*steps)++;
+    // Insert-only and lock-free: many threads may call this at once as long as nothing else uses
+    // the map meanwhile. Lanes are claimed with a CAS on the occupancy mask. There are no cuckoo
+    // moves, stash or grow(), so the map has to be sized up front and a key whose buckets are
+    // both full is reported by returning false.
+    bool insert_concurrent(Key key, Value value) {
+        if (!place_concurrent(key, value))
+            return false;
+        std::atomic_ref{size_}.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Inserts all entries from `threads` threads through place_concurrent. Entries that do not
+    // fit are inserted with insert() afterwards; returns how many needed that fallback. Assumes
+    // none of the keys is in the map already or twice in `entries`.
+    uint64_t build(
+        std::span<const std::pair<Key, Value>> entries,
+        uint64_t threads = std::thread::hardware_concurrency()) {
+        finish_migration();
+        threads = std::max<uint64_t>(threads, 1);
+        uint64_t per_thread = (entries.size() + threads - 1) / threads;
+        std::vector<std::vector<std::pair<Key, Value>>> overflow(threads);
+        std::atomic<uint64_t> placed{0};
+        std::vector<std::thread> workers{};
+        for (uint64_t t = 0; t < threads; t++) {
+            workers.emplace_back([&, t] {
+                uint64_t begin = std::min(t * per_thread, entries.size());
+                uint64_t end = std::min(begin + per_thread, entries.size());
+                uint64_t count = 0;
+                for (uint64_t i = begin; i < end; i++) {
+                    if (place_concurrent(entries[i].first, entries[i].second)) {
+                        count++;
+                    } else {
+                        overflow[t].emplace_back(entries[i]);
+                    }
+                }
+                placed.fetch_add(count, std::memory_order_relaxed);
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        size_ += placed.load();
+
+        uint64_t fallbacks = 0;
+        for (const auto& rest : overflow) {
+            for (const auto& [key, value] : rest)
+                insert(key, value);
+            fallbacks += rest.size();
         }
+        return fallbacks;
     }
 
-    bool contains(Key key, uint64_t* steps) {
+    // insert_concurrent without touching size_.
+    bool place_concurrent(Key key, Value value) {
         uint64_t hash = TableTrait::hash(key);
-        uint64_t index_1 = hash & (capacity - 1);
-        uint64_t index_2 = (hash >> 32) & (capacity - 1);
-        Slot* slot_1 = &data[index_1];
-        Slot* slot_2 = &data[index_2];
-        for (uint64_t i = 0; i < BUCKET && (slot_1->keys[i] != EMPTY || slot_2->keys[i] != EMPTY);
-             i++) {
-            if (slot_1->keys[i] == key)
+        uint64_t index_1 = bucket_1(hash, capacity);
+        uint64_t index_2 = bucket_2(hash, capacity);
+        std::atomic_ref mask_1{occupied[index_1]};
+        std::atomic_ref mask_2{occupied[index_2]};
+        for (;;) {
+            Mask old_1 = mask_1.load(std::memory_order_relaxed);
+            Mask old_2 = mask_2.load(std::memory_order_relaxed);
+            uint64_t free_1 = ~uint64_t{old_1} & FULL;
+            uint64_t free_2 = ~uint64_t{old_2} & FULL;
+            if ((free_1 | free_2) == 0)
+                return false;
+            bool first = std::popcount(free_1) >= std::popcount(free_2);
+            uint64_t index = first ? index_1 : index_2;
+            uint64_t lane = simd::first<BUCKET>(first ? free_1 : free_2);
+            Mask old = first ? old_1 : old_2;
+            Mask claimed = static_cast<Mask>(old | (uint64_t{1} << lane));
+            if ((first ? mask_1 : mask_2).compare_exchange_weak(
+                    old, claimed, std::memory_order_relaxed)) {
+                // The lane is ours alone, joining the threads publishes it.
+                data.key(index, lane) = key;
+                data.value(index, lane) = value;
+                if constexpr (TAGS)
+                    tags[index * BUCKET + lane] = tag_of(hash);
                 return true;
-            (*steps)++;
-            if (slot_2->keys[i] == key)
+            }
+        }
+    }
+
+    // Stores `key` in the current generation without touching size_.
+    void put(Key key, Value value) {
+        put(TableTrait::hash(key), key, value);
+    }
+
+    void put(uint64_t hash, Key key, Value value) {
+        if (!try_put(hash, key, value)) {
+            grow();
+            put(key, value);
+        }
+    }
+
+    // put() that never grows. Returns false if no room was left even after cuckoo moves and the
+    // stash; `key` and `value` then hold the entry left over, which may be one evicted on the way.
+    // FIRST_FIT takes the first bucket whenever it has a free lane instead of the emptier one.
+    template <bool FIRST_FIT = false>
+    bool try_put(uint64_t hash, Key& key, Value& value) {
+        if (place_free<FIRST_FIT>(hash, key, value))
+            return true;
+        return displace(
+            bucket_1(hash, capacity), bucket_2(hash, capacity), key, value, tag_of(hash));
+    }
+
+    // Stores the entry in a free lane of the emptier of its two buckets and returns its value
+    // slot, or nullptr if both are full. FIRST_FIT as in try_put().
+    template <bool FIRST_FIT = false>
+    Value* place_free(uint64_t hash, Key key, Value value) {
+        uint64_t index_1 = bucket_1(hash, capacity);
+        uint64_t index_2 = bucket_2(hash, capacity);
+        uint64_t free_1 = ~uint64_t{occupied[index_1]} & FULL;
+        uint64_t free_2 = ~uint64_t{occupied[index_2]} & FULL;
+        if ((free_1 | free_2) == 0)
+            return nullptr;
+        bool first = (FIRST_FIT && free_1) || std::popcount(free_1) >= std::popcount(free_2);
+        uint64_t index = first ? index_1 : index_2;
+        uint64_t lane = simd::first<BUCKET>(first ? free_1 : free_2);
+        place(index, lane, key, value, tag_of(hash));
+        return &data.value(index, lane);
+    }
+
+    // Both candidate buckets are full: random-walk cuckoo eviction. A random resident of the
+    // current bucket is swapped out and moved to its alternate bucket, for up to max_kicks
+    // moves, then the stash is tried.
+    bool displace(uint64_t index_1, uint64_t index_2, Key& key, Value& value, uint8_t tag) {
+        uint64_t index = next_random() & 1 ? index_1 : index_2;
+        for (uint64_t kick = 0; kick < max_kicks; kick++) {
+            uint64_t lane = next_random() % BUCKET;
+            std::swap(key, data.key(index, lane));
+            std::swap(value, data.value(index, lane));
+            if constexpr (TAGS)
+                std::swap(tag, tags[index * BUCKET + lane]);
+
+            uint64_t hash = TableTrait::hash(key);
+            uint64_t alt_1 = bucket_1(hash, capacity);
+            uint64_t alt_2 = bucket_2(hash, capacity);
+            index = index == alt_1 ? alt_2 : alt_1;
+            uint64_t free = ~uint64_t{occupied[index]} & FULL;
+            if (free) {
+                place(index, simd::first<BUCKET>(free), key, value, tag);
                 return true;
-            (*steps)++;
+            }
+        }
+        if (stash_size < STASH) {
+            stash_keys[stash_size] = key;
+            stash_values[stash_size] = value;
+            stash_size++;
+            return true;
         }
         return false;
     }
 
+    // assumes key is in the map, see find_ptr
+    Value find(Key key) {
+        if (old_data)
+            migrate(migrate_step);
+        return *lookup(TableTrait::hash(key), key);
+    }
+
+    // nullptr if the key is absent. A miss costs the same two mask probes as a hit.
+    Value* find_ptr(Key key) {
+        if (old_data)
+            migrate(migrate_step);
+        return lookup(TableTrait::hash(key), key);
+    }
+
+    bool contains(Key key) {
+        if (old_data)
+            migrate(migrate_step);
+        return lookup(TableTrait::hash(key), key) != nullptr;
+    }
+
     void erase(Key key) {
         uint64_t hash = TableTrait::hash(key);
-        uint64_t index_1 = hash & (capacity - 1);
-        uint64_t index_2 = (hash >> 32) & (capacity - 1);
-        Slot* slot_1 = &data[index_1];
-        Slot* slot_2 = &data[index_2];
-        for (uint64_t i = 0;; i++) {
-            if (slot_1->keys[i] == key) {
-                for (uint64_t j = i; j < BUCKET - 1; j++) {
-                    slot_1->keys[j] = slot_1->keys[j + 1];
-                    slot_1->values[j] = slot_1->values[j + 1];
-                }
-                slot_1->keys[BUCKET - 1] = EMPTY;
-                size_--;
+        if (erase_from(data, occupied, tags, capacity, hash, key) ||
+            (old_data && erase_from(old_data, old_occupied, old_tags, old_capacity, hash, key)) ||
+            (stash_size && erase_from_stash(key)))
+            size_--;
+    }
+
+    // Read-modify-write with one hash and one probe of the two buckets: a miss places the key
+    // straight into a free lane of the buckets the probe just loaded. Only when both are full
+    // does it take the cuckoo/stash/grow path of insert() and look the key up again.
+    //
+    // Returns the value of `key` and whether it was inserted with `value` just now. The pointer
+    // stays valid until the next insertion or erase.
+    std::pair<Value*, bool> try_emplace(Key key, Value value = Value{}) {
+        if (old_data)
+            migrate(migrate_step);
+        uint64_t hash = TableTrait::hash(key);
+        if (Value* found = lookup(hash, key))
+            return {found, false};
+        if (Value* slot = place_free(hash, key, value)) [[likely]] {
+            size_++;
+            return {slot, true};
+        }
+        put(hash, key, value);
+        size_++;
+        return {lookup(hash, key), true};
+    }
+
+    // Returns true if `key` was inserted, false if an existing value was overwritten.
+    bool insert_or_assign(Key key, Value value) {
+        auto [slot, inserted] = try_emplace(key, value);
+        if (!inserted)
+            *slot = value;
+        return inserted;
+    }
+
+    // The value of `key`, inserted as `value` first if absent.
+    Value& find_or_insert(Key key, Value value = Value{}) {
+        return *try_emplace(key, value).first;
+    }
+
+    Value& operator[](Key key) {
+        return find_or_insert(key);
+    }
+
+    // Calls f(Value&) on the value of `key`, inserted as Value{} first if absent. Returns true if
+    // it was inserted.
+    bool update(Key key, auto&& f) {
+        auto [slot, inserted] = try_emplace(key);
+        f(*slot);
+        return inserted;
+    }
+
+    // Next capacity: one growth step, but never less than what size() needs at RESERVE_LOAD.
+    void grow() {
+        resize(std::max(next_capacity(capacity), buckets_for(size_ + 1)));
+    }
+
+    uint64_t next_capacity(uint64_t buckets) {
+        uint64_t scaled = static_cast<uint64_t>(static_cast<double>(buckets) * growth);
+        return std::max(scaled, buckets + 1);
+    }
+
+    // Sizes the table for `entries` entries in total at RESERVE_LOAD, so inserting up to that many
+    // does not grow. Never shrinks.
+    void reserve(uint64_t entries) {
+        uint64_t buckets = buckets_for(entries);
+        if (buckets > capacity) {
+            resize(buckets);
+            finish_migration();
+        }
+    }
+
+    static uint64_t buckets_for(uint64_t entries) {
+        return static_cast<uint64_t>(
+            std::ceil(static_cast<double>(entries) / (RESERVE_LOAD * BUCKET)));
+    }
+
+    // Moves to `buckets` buckets, incrementally if migrate_step > 0.
+    void resize(uint64_t buckets) {
+        if (old_data)
+            finish_migration();
+        if (migrate_step == 0) {
+            rehash(buckets);
+            return;
+        }
+        old_capacity = capacity;
+        old_data = data;
+        old_occupied = occupied;
+        old_tags = tags;
+        migrated = 0;
+        capacity = buckets;
+        allocate();
+        drain_stash();
+    }
+
+    // The whole-table rehash behind grow() when migrate_step == 0. Entries are copied out of the
+    // untouched old arrays with try_put(), which never grows; if one does not fit, the new arrays
+    // are dropped and the pass restarts one growth step larger, so a rehash never cascades.
+    //
+    // Old buckets are staged REHASH_AHEAD buckets before they are placed: their keys are hashed
+    // then and both destination buckets prefetched, and the source is prefetched further ahead
+    // still. Entries that sat in their first bucket keep their relative order under the
+    // multiply-high, so placing first-fit makes most stores walk the new arrays front to back.
+    void rehash(uint64_t buckets) {
+        Buckets from = data;
+        Mask* from_occupied = occupied;
+        uint8_t* from_tags = tags;
+        uint64_t from_capacity = capacity;
+        Key spill_keys[STASH];
+        Value spill_values[STASH];
+        uint64_t spilled = stash_size;
+        std::copy_n(stash_keys, spilled, spill_keys);
+        std::copy_n(stash_values, spilled, spill_values);
+        for (;; buckets = next_capacity(buckets)) {
+            capacity = buckets;
+            stash_size = 0;
+            allocate();
+            if (rehash_from(from, from_occupied, from_capacity) &&
+                rehash_spill(spill_keys, spill_values, spilled))
+                break;
+            release(data, occupied, tags);
+        }
+        release(from, from_occupied, from_tags);
+    }
+
+    static constexpr uint64_t REHASH_AHEAD = 8;
+
+    bool rehash_from(const Buckets& from, const Mask* from_occupied, uint64_t from_capacity) {
+        struct Staged {
+            Key keys[BUCKET];
+            Value values[BUCKET];
+            uint64_t hashes[BUCKET];
+            uint64_t count;
+        };
+        Staged staged[REHASH_AHEAD];
+        auto stage = [&](uint64_t index) {
+            Staged& next = staged[index % REHASH_AHEAD];
+            next.count = 0;
+            if (index >= from_capacity)
                 return;
+            if (index + REHASH_AHEAD < from_capacity) {
+                from.prefetch(index + REHASH_AHEAD);
+                ::prefetch(&from_occupied[index + REHASH_AHEAD]);
             }
-            if (slot_2->keys[i] == key) {
-                for (uint64_t j = i; j < BUCKET - 1; j++) {
-                    slot_2->keys[j] = slot_2->keys[j + 1];
-                    slot_2->values[j] = slot_2->values[j + 1];
-                }
-                slot_2->keys[BUCKET - 1] = EMPTY;
-                size_--;
-                return;
+            for (uint64_t mask = from_occupied[index]; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                Key key = from.key(index, lane);
+                uint64_t hash = TableTrait::hash(key);
+                uint64_t index_1 = bucket_1(hash, capacity);
+                uint64_t index_2 = bucket_2(hash, capacity);
+                data.prefetch(index_1);
+                data.prefetch(index_2);
+                ::prefetch(&occupied[index_1]);
+                ::prefetch(&occupied[index_2]);
+                next.keys[next.count] = key;
+                next.values[next.count] = from.value(index, lane);
+                next.hashes[next.count] = hash;
+                next.count++;
             }
+        };
+
+        for (uint64_t index = 0; index < REHASH_AHEAD; index++)
+            stage(index);
+        for (uint64_t index = 0; index < from_capacity; index++) {
+            Staged& ready = staged[index % REHASH_AHEAD];
+            for (uint64_t i = 0; i < ready.count; i++) {
+                if (!try_put<true>(ready.hashes[i], ready.keys[i], ready.values[i]))
+                    return false;
+            }
+            stage(index + REHASH_AHEAD);
         }
+        return true;
     }
 
-    void grow() {
-        uint64_t old_capacity = capacity;
-        Slot* old_data = data;
-        size_ = 0;
-        capacity *= 2;
-        data = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * capacity));
-        fill_empty(data, capacity);
-        for (uint64_t i = 0; i < old_capacity; i++) {
-            Slot* slot = &old_data[i];
-            for (uint64_t j = 0; j < BUCKET && slot->keys[j] != EMPTY; j++) {
-                insert(slot->keys[j], slot->values[j]);
+    bool rehash_spill(Key* keys, Value* values, uint64_t count) {
+        for (uint64_t i = 0; i < count; i++) {
+            Key key = keys[i];
+            Value value = values[i];
+            if (!try_put(TableTrait::hash(key), key, value))
+                return false;
+        }
+        return true;
+    }
+
+    // Moves up to `buckets` old-generation buckets into the current arrays.
+    void migrate(uint64_t buckets) {
+        for (; buckets > 0 && old_data; buckets--) {
+            // Claim the bucket first: a put() below may grow and re-enter the migration.
+            uint64_t index = migrated++;
+            Key keys[BUCKET];
+            Value values[BUCKET];
+            uint64_t lanes = old_occupied[index];
+            for (uint64_t mask = lanes; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                keys[lane] = old_data.key(index, lane);
+                values[lane] = old_data.value(index, lane);
+            }
+            old_occupied[index] = 0;
+            if (migrated == old_capacity)
+                release(old_data, old_occupied, old_tags);
+            for (; lanes; lanes &= lanes - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(lanes));
+                put(keys[lane], values[lane]);
             }
         }
-        __aligned_free(old_data);
     }
 
+    void finish_migration() {
+        while (old_data)
+            migrate(old_capacity - migrated);
+    }
+
+    // Re-places stashed entries after a grow; most now fit in their buckets.
+    void drain_stash() {
+        Key keys[STASH];
+        Value values[STASH];
+        uint64_t count = stash_size;
+        std::copy_n(stash_keys, count, keys);
+        std::copy_n(stash_values, count, values);
+        stash_size = 0;
+        for (uint64_t i = 0; i < count; i++)
+            put(keys[i], values[i]);
+    }
+
+    // Only resets the occupancy masks, keys, values and tags are left as they are.
     void clear() {
         size_ = 0;
-        fill_empty(data, capacity);
+        stash_size = 0;
+        release(old_data, old_occupied, old_tags);
+        std::memset(occupied, 0, sizeof(Mask) * capacity);
+    }
+
+    // Writes the table as a snapshot; false on any I/O error, which leaves an existing file at
+    // `path` untouched. Finishes a pending migration.
+    bool save(const char* path) {
+        finish_migration();
+        // A mapped table came from save() already and cannot be written to.
+        if (!mapping)
+            scrub();
+        snapshot::Writer writer{path};
+        snapshot_sections([&](void* memory, uint64_t bytes) { writer.section(memory, bytes); });
+        return writer.finish(snapshot_header());
+    }
+
+    // Maps a snapshot written by save() with the same template arguments and hash. Lookups run
+    // straight on the read-only mapping, so the map must not be modified. With `verify` the
+    // payload checksum is checked first, which reads the whole file. nullptr if the file is
+    // missing, does not match this map type, or is corrupt.
+    static std::unique_ptr<TwoWay> open_mapped(const char* path, bool verify = true) {
+        snapshot::Mapping mapping{path};
+        snapshot::Header header{};
+        if (!mapping || mapping.size() < snapshot::HEADER_BYTES)
+            return nullptr;
+        std::memcpy(&header, mapping.data(), sizeof(header));
+        auto map = std::make_unique<TwoWay>();
+        snapshot::Header expected = map->snapshot_header();
+        expected.capacity = header.capacity;
+        expected.size = header.size;
+        expected.stash_size = header.stash_size;
+        expected.payload_bytes = mapping.size() - snapshot::HEADER_BYTES;
+        expected.checksum = header.checksum;
+        if (std::memcmp(&header, &expected, sizeof(header)) != 0 || header.stash_size > STASH ||
+            header.payload_bytes != snapshot_bytes(header.capacity))
+            return nullptr;
+        if (verify && snapshot::checksum(
+                          mapping.data() + snapshot::HEADER_BYTES, header.payload_bytes) !=
+                          header.checksum)
+            return nullptr;
+
+        release(map->data, map->occupied, map->tags);
+        map->capacity = header.capacity;
+        map->size_ = header.size;
+        map->stash_size = header.stash_size;
+        std::byte* at = mapping.data() + snapshot::HEADER_BYTES;
+        auto take = [&](uint64_t bytes) {
+            std::byte* memory = at;
+            at += snapshot::padded(bytes);
+            return memory;
+        };
+        map->occupied = reinterpret_cast<Mask*>(take(sizeof(Mask) * map->capacity));
+        if constexpr (TAGS)
+            map->tags = reinterpret_cast<uint8_t*>(take(BUCKET * map->capacity));
+        map->data.adopt(map->capacity, take);
+        std::memcpy(map->stash_keys, take(sizeof(stash_keys)), sizeof(stash_keys));
+        std::memcpy(map->stash_values, take(sizeof(stash_values)), sizeof(stash_values));
+        map->mapping = std::move(mapping);
+        return map;
+    }
+
+    // Zeroes the free lanes and stash entries, so no uninitialised heap bytes reach a snapshot.
+    void scrub() {
+        for (uint64_t i = 0; i < capacity; i++) {
+            for (uint64_t mask = ~uint64_t{occupied[i]} & FULL; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                std::memset(&data.key(i, lane), 0, sizeof(Key));
+                if constexpr (!std::is_empty_v<Value>)
+                    std::memset(&data.value(i, lane), 0, sizeof(Value));
+                if constexpr (TAGS)
+                    tags[i * BUCKET + lane] = 0;
+            }
+        }
+        std::memset(stash_keys + stash_size, 0, sizeof(Key) * (STASH - stash_size));
+        std::memset(stash_values + stash_size, 0, sizeof(Value) * (STASH - stash_size));
+    }
+
+    // Everything save() writes after the header, in file order, as f(memory, bytes).
+    void snapshot_sections(auto&& f) {
+        f(occupied, sizeof(Mask) * capacity);
+        if constexpr (TAGS)
+            f(tags, BUCKET * capacity);
+        data.regions(capacity, f);
+        f(stash_keys, sizeof(stash_keys));
+        f(stash_values, sizeof(stash_values));
+    }
+
+    // What snapshot_sections() adds up to, padding included, for `buckets` buckets.
+    static uint64_t snapshot_bytes(uint64_t buckets) {
+        uint64_t bytes = snapshot::padded(sizeof(Mask) * buckets) +
+                         snapshot::padded(sizeof(Key) * STASH) +
+                         snapshot::padded(sizeof(Value) * STASH);
+        if constexpr (TAGS)
+            bytes += snapshot::padded(BUCKET * buckets);
+        Buckets{}.regions(buckets, [&](const void*, uint64_t region) {
+            bytes += snapshot::padded(region);
+        });
+        return bytes;
+    }
+
+    snapshot::Header snapshot_header() {
+        snapshot::Header header{};
+        std::memcpy(header.magic, snapshot::MAGIC, sizeof(header.magic));
+        header.version = snapshot::VERSION;
+        header.layout = Layout::ID;
+        header.capacity = capacity;
+        header.size = size_;
+        header.bucket = BUCKET;
+        header.key_bytes = sizeof(Key);
+        header.value_bytes = sizeof(Value);
+        header.tags = TAGS;
+        header.hash_identity = hash_identity();
+        header.stash_size = stash_size;
+        return header;
+    }
+
+    // Fingerprint of TableTrait::hash: the hashes of a few small and a few scrambled key bit
+    // patterns.
+    static uint64_t hash_identity() {
+        uint64_t identity = 0;
+        for (uint64_t i = 0; i < 8; i++) {
+            Key key{};
+            uint64_t pattern = i < 4 ? i : squirrel3(i);
+            std::memcpy(&key, &pattern, std::min(sizeof(Key), sizeof(pattern)));
+            identity = squirrel3(identity ^ static_cast<uint64_t>(TableTrait::hash(key)));
+        }
+        return identity;
     }
 
     uint64_t index_for(Key key) {
@@ -150,60 +669,431 @@ struct TwoWay {
     }
     uint64_t prefetch(Key key) {
         uint64_t hash = TableTrait::hash(key);
-        uint64_t index_1 = hash & (capacity - 1);
-        uint64_t index_2 = (hash >> 32) & (capacity - 1);
-        prefetch(data[index_1].keys);
-        prefetch(data[index_1].values);
-        prefetch(data[index_2].keys);
-        prefetch(data[index_2].values);
+        uint64_t index_1 = bucket_1(hash, capacity);
+        uint64_t index_2 = bucket_2(hash, capacity);
+        data.prefetch(index_1);
+        data.prefetch(index_2);
+        if constexpr (TAGS) {
+            ::prefetch(&tags[index_1 * BUCKET]);
+            ::prefetch(&tags[index_2 * BUCKET]);
+        }
         return hash;
     }
-    Value find_indexed(Key key, uint64_t hash, uint64_t* steps) {
-        uint64_t index_1 = hash & (capacity - 1);
-        uint64_t index_2 = (hash >> 32) & (capacity - 1);
-        Slot* slot_1 = &data[index_1];
-        Slot* slot_2 = &data[index_2];
-        for (uint64_t i = 0;; i++) {
-            if (slot_1->keys[i] == key)
-                return slot_1->values[i];
-            (*steps)++;
-            if (slot_2->keys[i] == key)
-                return slot_2->values[i];
-            (*steps)++;
-        }
+    Value find_indexed(Key key, uint64_t hash) {
+        return *lookup(hash, key);
+    }
+    bool contains_indexed(Key key, uint64_t hash) {
+        return lookup(hash, key) != nullptr;
+    }
+
+    // Batched lookups: keys are hashed and both buckets prefetched GROUP keys ahead of the key
+    // being resolved, so up to GROUP bucket misses are in flight instead of one at a time.
+    // out[i] receives the value of keys[i], or Value{} if it is absent.
+    template <uint64_t GROUP = 16>
+    void find_many(std::span<const Key> keys, std::span<Value> out) {
+        pipelined<GROUP>(keys, [&](uint64_t i, Key key, uint64_t hash) {
+            const Value* value = lookup(hash, key);
+            out[i] = value ? *value : Value{};
+        });
+    }
+
+    // Bit i % 64 of hits[i / 64] is set iff keys[i] is present. `hits` needs
+    // ceil(keys.size() / 64) words.
+    template <uint64_t GROUP = 16>
+    void contains_many(std::span<const Key> keys, std::span<uint64_t> hits) {
+        std::fill(hits.begin(), hits.end(), 0);
+        pipelined<GROUP>(keys, [&](uint64_t i, Key key, uint64_t hash) {
+            hits[i / 64] |= static_cast<uint64_t>(contains_indexed(key, hash)) << (i % 64);
+        });
     }
 
     uint64_t size() {
         return size_;
     }
 
+    double load_factor() {
+        return static_cast<double>(size_) / static_cast<double>(capacity * BUCKET);
+    }
+
     uint64_t memory_usage() {
-        return sizeof(Slot) * capacity + sizeof(TwoWay);
+        uint64_t buckets = capacity + (old_data ? old_capacity : 0);
+        return (Buckets::BYTES_PER_BUCKET + sizeof(Mask) + (TAGS ? BUCKET : 0)) * buckets +
+               sizeof(TwoWay);
     }
 
-    Value sum_all_values() {
-        Value sum{};
+    // Occupancy and placement of the entries, see stats::Occupancy. Rehashes every stored key.
+    // Finishes a pending migration first.
+    stats::Occupancy stats() {
+        finish_migration();
+        stats::Occupancy occupancy{};
+        occupancy.size = size_;
+        occupancy.buckets = capacity;
+        occupancy.load_factor = load_factor();
+        occupancy.fill.assign(BUCKET + 1, 0);
+        uint64_t second = 0;
+        uint64_t lengths = 0;
         for (uint64_t i = 0; i < capacity; i++) {
-            Slot* slot = &data[i];
-            for (uint64_t j = 0; j < BUCKET && slot->keys[j] != EMPTY; j++) {
-                sum += slot->values[j];
+            occupancy.fill[static_cast<uint64_t>(std::popcount(occupied[i]))]++;
+            for (uint64_t mask = occupied[i]; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                uint64_t in_second = bucket_1(TableTrait::hash(data.key(i, lane)), capacity) != i;
+                second += in_second;
+                lengths += 2 * lane + in_second;
             }
         }
+        for (uint64_t lane = 0; lane < stash_size; lane++)
+            lengths += 2 * BUCKET + lane;
+        const double entries = static_cast<double>(std::max<uint64_t>(size_, 1));
+        occupancy.second_fraction = static_cast<double>(second) / entries;
+        occupancy.stashed = stash_size;
+        occupancy.hit_cost = static_cast<double>(lengths) / entries;
+        occupancy.miss_cost =
+            2.0 * static_cast<double>(size_ - stash_size) / static_cast<double>(capacity) +
+            static_cast<double>(stash_size);
+        occupancy.bytes_per_entry = static_cast<double>(memory_usage()) / entries;
+        return occupancy;
+    }
+
+    // Full-table aggregate: one masked vector sum per bucket (see Layout::sum), so the scan runs
+    // straight through the bucket array without branching on which lanes are live.
+    Value sum_all_values() {
+        Value sum{};
+        for (uint64_t i = 0; i < capacity; i++)
+            sum += data.sum(i, occupied[i]);
+        for (uint64_t i = old_data ? migrated : old_capacity; i < old_capacity; i++)
+            sum += old_data.sum(i, old_occupied[i]);
+        for (uint64_t i = 0; i < stash_size; i++)
+            sum += stash_values[i];
         return sum;
     }
 
-    struct Slot {
-        Key keys[BUCKET];
-        Value values[BUCKET];
+    // Calls f(key, value) for every entry, in no particular order; values may be modified.
+    void for_each(auto&& f) {
+        for_each_in(data, occupied, 0, capacity, f);
+        if (old_data)
+            for_each_in(old_data, old_occupied, migrated, old_capacity, f);
+        for (uint64_t i = 0; i < stash_size; i++)
+            f(stash_keys[i], stash_values[i]);
+    }
+
+    static void for_each_in(
+        const Buckets& buckets,
+        const Mask* masks,
+        uint64_t begin,
+        uint64_t end,
+        auto&& f) {
+        for (uint64_t i = begin; i < end; i++) {
+            for (uint64_t mask = masks[i]; mask; mask &= mask - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+                f(std::as_const(buckets.key(i, lane)), buckets.value(i, lane));
+            }
+        }
+    }
+
+    struct Entry {
+        const Key& key;
+        Value& value;
     };
 
-    static void fill_empty(Slot* slots, uint64_t count) {
-        for (uint64_t idx = 0; idx < count; idx++) {
-            std::fill_n(slots[idx].keys, BUCKET, EMPTY);
+    // Forward iterator over the buckets and then the stash. begin() finishes a pending
+    // migration first, so only one generation has to be walked.
+    class iterator {
+    public:
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        iterator(TwoWay* owner, uint64_t index, uint64_t lanes)
+            : map(owner), bucket(index), mask(lanes) {
+            skip_empty();
+        }
+
+        Entry operator*() const {
+            uint64_t lane = static_cast<uint64_t>(std::countr_zero(mask));
+            if (bucket < map->capacity)
+                return {map->data.key(bucket, lane), map->data.value(bucket, lane)};
+            return {map->stash_keys[lane], map->stash_values[lane]};
+        }
+        iterator& operator++() {
+            mask &= mask - 1;
+            skip_empty();
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator before = *this;
+            ++*this;
+            return before;
+        }
+        bool operator==(const iterator& other) const {
+            return bucket == other.bucket && mask == other.mask;
+        }
+
+    private:
+        // Bucket `capacity` stands for the stash.
+        uint64_t lanes_of(uint64_t index) const {
+            if (index < map->capacity)
+                return map->occupied[index];
+            return (uint64_t{1} << map->stash_size) - 1;
+        }
+        void skip_empty() {
+            while (mask == 0 && bucket < map->capacity)
+                mask = lanes_of(++bucket);
+        }
+
+        TwoWay* map = nullptr;
+        uint64_t bucket = 0;
+        uint64_t mask = 0;
+    };
+
+    iterator begin() {
+        finish_migration();
+        return iterator{this, 0, occupied[0]};
+    }
+    iterator end() {
+        return iterator{this, capacity, 0};
+    }
+
+    template <uint64_t GROUP, typename F>
+    void pipelined(std::span<const Key> keys, F&& resolve) {
+        static_assert(std::has_single_bit(GROUP));
+        uint64_t hashes[GROUP];
+        uint64_t n = keys.size();
+        for (uint64_t i = 0; i < std::min(n, GROUP); i++)
+            hashes[i] = prefetch(keys[i]);
+        for (uint64_t i = 0; i < n; i++) {
+            uint64_t hash = hashes[i % GROUP];
+            if (i + GROUP < n)
+                hashes[i % GROUP] = prefetch(keys[i + GROUP]);
+            resolve(i, keys[i], hash);
+        }
+    }
+
+    uint64_t next_random() {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        return rng;
+    }
+
+    // Maps a 32-bit hash half onto [0, count) as (half * count) >> 32.
+    static constexpr uint64_t bucket_1(uint64_t hash, uint64_t count) {
+        return ((hash & 0xFFFFFFFF) * count) >> 32;
+    }
+    static constexpr uint64_t bucket_2(uint64_t hash, uint64_t count) {
+        return ((hash >> 32) * count) >> 32;
+    }
+
+    // The bucket indexes are decided by the top bits of each half, so the tag uses the low byte.
+    static uint8_t tag_of(uint64_t hash) {
+        return static_cast<uint8_t>(hash);
+    }
+
+    // Occupied lanes of bucket `index` that hold `key`.
+    static uint64_t key_mask(
+        const Buckets& buckets,
+        const Mask* masks,
+        [[maybe_unused]] const uint8_t* bucket_tags,
+        uint64_t index,
+        Key key,
+        [[maybe_unused]] uint8_t tag) {
+        if constexpr (TAGS) {
+            uint64_t mask = 0;
+            uint64_t candidates =
+                simd::match<uint8_t, BUCKET>(&bucket_tags[index * BUCKET], tag) & masks[index];
+            for (; candidates; candidates &= candidates - 1) {
+                uint64_t lane = static_cast<uint64_t>(std::countr_zero(candidates));
+                mask |= static_cast<uint64_t>(buckets.key(index, lane) == key) << lane;
+            }
+            return mask;
+        } else {
+            return buckets.match(index, key) & masks[index];
         }
     }
 
-    Slot* data;
+    void place(uint64_t index, uint64_t lane, Key key, Value value, [[maybe_unused]] uint8_t tag) {
+        data.key(index, lane) = key;
+        data.value(index, lane) = value;
+        occupied[index] = static_cast<Mask>(occupied[index] | (uint64_t{1} << lane));
+        if constexpr (TAGS)
+            tags[index * BUCKET + lane] = tag;
+    }
+
+    // Compares `key` against both buckets at once and resolves the hit from the match masks.
+    // Falls back to the old generation while a migration is in progress.
+    Value* lookup(uint64_t hash, Key key) {
+        Value* value = probe(data, occupied, tags, capacity, hash, key, probe_stats);
+        if (value == nullptr && old_data) [[unlikely]]
+            value = probe(old_data, old_occupied, old_tags, old_capacity, hash, key, probe_stats);
+        if (value == nullptr && stash_size) [[unlikely]] {
+            uint64_t lane = stash_lane(key);
+            if (lane < STASH) {
+                probe_stats.hit(stats::STASH, lane, 2 * BUCKET + lane);
+                value = &stash_values[lane];
+            }
+        }
+        if (value == nullptr)
+            probe_stats.miss();
+        return value;
+    }
+
+    // Index of `key` among the live stash entries, or STASH.
+    uint64_t stash_lane(Key key) {
+        uint64_t live = (uint64_t{1} << stash_size) - 1;
+        return simd::first<STASH>(simd::match<Key, STASH>(stash_keys, key) & live);
+    }
+
+    bool erase_from_stash(Key key) {
+        uint64_t lane = stash_lane(key);
+        if (lane == STASH)
+            return false;
+        stash_size--;
+        stash_keys[lane] = stash_keys[stash_size];
+        stash_values[lane] = stash_values[stash_size];
+        return true;
+    }
+
+    static Value* probe(
+        const Buckets& buckets,
+        const Mask* masks,
+        const uint8_t* bucket_tags,
+        uint64_t bucket_count,
+        uint64_t hash,
+        Key key,
+        Stats& recorder) {
+        uint64_t index_1 = bucket_1(hash, bucket_count);
+        uint64_t index_2 = bucket_2(hash, bucket_count);
+        uint64_t m_1 = key_mask(buckets, masks, bucket_tags, index_1, key, tag_of(hash));
+        uint64_t m_2 = key_mask(buckets, masks, bucket_tags, index_2, key, tag_of(hash));
+        if ((m_1 | m_2) == 0)
+            return nullptr;
+        uint64_t lane = simd::first<BUCKET>(m_1 ? m_1 : m_2);
+        recorder.hit(m_1 ? stats::FIRST : stats::SECOND, lane, 2 * lane + (m_1 ? 0 : 1));
+        return &buckets.value(m_1 ? index_1 : index_2, lane);
+    }
+
+    // Only clears the occupancy bit, the rest of the bucket stays in place.
+    static bool erase_from(
+        const Buckets& buckets,
+        Mask* masks,
+        const uint8_t* bucket_tags,
+        uint64_t bucket_count,
+        uint64_t hash,
+        Key key) {
+        uint64_t index_1 = bucket_1(hash, bucket_count);
+        uint64_t index_2 = bucket_2(hash, bucket_count);
+        uint64_t m_1 = key_mask(buckets, masks, bucket_tags, index_1, key, tag_of(hash));
+        uint64_t m_2 = key_mask(buckets, masks, bucket_tags, index_2, key, tag_of(hash));
+        if ((m_1 | m_2) == 0)
+            return false;
+        uint64_t index = m_1 ? index_1 : index_2;
+        uint64_t lane = simd::first<BUCKET>(m_1 ? m_1 : m_2);
+        masks[index] = static_cast<Mask>(masks[index] & ~(uint64_t{1} << lane));
+        return true;
+    }
+
+    // Only the occupancy masks are zeroed; keys, values and tags start out uninitialised.
+    void allocate() {
+        data.allocate(capacity);
+        occupied = reinterpret_cast<Mask*>(__aligned_alloc(CACHE_LINE, sizeof(Mask) * capacity));
+        std::memset(occupied, 0, sizeof(Mask) * capacity);
+        if constexpr (TAGS)
+            tags = reinterpret_cast<uint8_t*>(__aligned_alloc(CACHE_LINE, BUCKET * capacity));
+    }
+
+    static void release(Buckets& buckets, Mask*& masks, uint8_t*& bucket_tags) {
+        buckets.release();
+        __aligned_free(masks);
+        __aligned_free(bucket_tags);
+        masks = nullptr;
+        bucket_tags = nullptr;
+    }
+
+    Buckets data;
+    Mask* occupied = nullptr;
+    uint8_t* tags = nullptr;
     uint64_t capacity;
     uint64_t size_;
+    // Cuckoo moves tried before an insert gives up and grows the table; 0 grows immediately.
+    uint64_t max_kicks = 64;
+    // Factor grow() scales the bucket count by, e.g. 1.5 for smaller memory steps.
+    double growth = 2.0;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+    // Old buckets moved per insert/find while growing; 0 rehashes everything inside grow().
+    uint64_t migrate_step = 0;
+    Buckets old_data;
+    Mask* old_occupied = nullptr;
+    uint8_t* old_tags = nullptr;
+    uint64_t old_capacity = 0;
+    uint64_t migrated = 0;
+
+    // Overflow entries, only the first stash_size are live.
+    Key stash_keys[STASH];
+    Value stash_values[STASH];
+    uint64_t stash_size = 0;
+
+    // Owns the file a map from open_mapped() points into; empty otherwise.
+    snapshot::Mapping mapping;
+
+    // What lookups recorded so far, see Stats.
+    [[no_unique_address]] Stats probe_stats;
+};
+
+// The Value of a TwoWaySet entry, which has none.
+struct NoValue {};
+
+template <typename T>
+concept SetTrait =
+    requires {
+        typename T::Key;
+
+        { T::hash(std::declval<typename T::Key>()) } -> std::convertible_to<uint64_t>;
+    } && std::is_trivially_copyable_v<typename T::Key>;
+
+// A SetTrait as the TableTrait of a set. Any Value of its own is shadowed, so map traits work.
+template <SetTrait Trait>
+struct KeysOf : Trait {
+    using Value = NoValue;
+};
+
+// Membership-only TwoWay: layout::KeysOnly drops the values array, so a default bucket of 8 u64
+// keys is one cache line where a map's also drags along a line of values. Probing, stash,
+// growth, stats and snapshots are TwoWay's.
+template <
+    SetTrait Trait,
+    uint64_t BUCKET = LINE_BUCKET<typename Trait::Key>,
+    bool TAGS = false,
+    typename Stats = stats::Off>
+struct TwoWaySet : TwoWay<KeysOf<Trait>, BUCKET, TAGS, layout::KeysOnly, Stats> {
+    using Map = TwoWay<KeysOf<Trait>, BUCKET, TAGS, layout::KeysOnly, Stats>;
+    using Key = typename Map::Key;
+    using Entry = std::pair<Key, NoValue>;
+
+    using Map::Map;
+    // Bulk load as TwoWay's, assumes no key appears twice.
+    explicit TwoWaySet(std::span<const Key> keys)
+        : Map(std::span<const Entry>{entries_of(keys)}) {}
+
+    // assumes key is not in the set, see try_insert
+    void insert(Key key) {
+        Map::insert(key, NoValue{});
+    }
+
+    // Returns true if `key` was not in the set yet.
+    bool try_insert(Key key) {
+        return Map::try_emplace(key).second;
+    }
+
+    // Calls f(key) for every key, in no particular order.
+    void for_each(auto&& f) {
+        Map::for_each([&](const Key& key, NoValue&) { f(key); });
+    }
+
+    static std::vector<Entry> entries_of(std::span<const Key> keys) {
+        std::vector<Entry> entries{};
+        entries.reserve(keys.size());
+        for (const auto key : keys)
+            entries.emplace_back(key, NoValue{});
+        return entries;
+    }
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <csignal>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
 
@@ -45,7 +46,7 @@ inline void __aligned_free(void* ptr) {
 }
 
 // These constants are all large primes.
-inline uint64_t squirrel3(uint64_t at) {
+constexpr uint64_t squirrel3(uint64_t at) {
     constexpr uint64_t BIT_NOISE1 = 0x9E3779B185EBCA87ULL;
     constexpr uint64_t BIT_NOISE2 = 0xC2B2AE3D27D4EB4FULL;
     constexpr uint64_t BIT_NOISE3 = 0x27D4EB2F165667C5ULL;
@@ -57,3 +58,55 @@ inline uint64_t squirrel3(uint64_t at) {
     at ^= (at >> 8);
     return at;
 }
+
+namespace permutation {
+inline constexpr uint64_t MUL_1 = 0xFF51AFD7ED558CCDULL;
+inline constexpr uint64_t MUL_2 = 0xC4CEB9FE1A85EC53ULL;
+
+template <uint64_t BITS>
+inline constexpr uint64_t MASK = BITS == 64 ? ~uint64_t{0} : (uint64_t{1} << BITS) - 1;
+
+// Inverse of an odd multiplier modulo 2^64, Newton's iteration doubles the correct low bits.
+constexpr uint64_t inverse(uint64_t odd) {
+    uint64_t x = odd;
+    for (int i = 0; i < 5; i++)
+        x *= 2 - odd * x;
+    return x;
+}
+
+// Undoes `x ^= x >> shift` on a BITS-bit x.
+template <uint64_t BITS>
+constexpr uint64_t unshift(uint64_t y, uint64_t shift) {
+    uint64_t x = y;
+    for (uint64_t s = shift; s < BITS; s += shift)
+        x ^= y >> s;
+    return x;
+}
+} // namespace permutation
+
+// Bijection on [0, 2^BITS): xorshift-multiply rounds modulo 2^BITS, every step invertible, so
+// unpermute() gets the key back and a table may keep only part of the result. `at` must be
+// below 2^BITS.
+template <uint64_t BITS>
+constexpr uint64_t permute(uint64_t at) {
+    using namespace permutation;
+    constexpr uint64_t SHIFT = (BITS + 1) / 2;
+    at ^= at >> SHIFT;
+    at = (at * MUL_1) & MASK<BITS>;
+    at ^= at >> SHIFT;
+    at = (at * MUL_2) & MASK<BITS>;
+    at ^= at >> SHIFT;
+    return at;
+}
+
+template <uint64_t BITS>
+constexpr uint64_t unpermute(uint64_t at) {
+    using namespace permutation;
+    constexpr uint64_t SHIFT = (BITS + 1) / 2;
+    at = unshift<BITS>(at, SHIFT);
+    at = (at * inverse(MUL_2)) & MASK<BITS>;
+    at = unshift<BITS>(at, SHIFT);
+    at = (at * inverse(MUL_1)) & MASK<BITS>;
+    at = unshift<BITS>(at, SHIFT);
+    return at;
+}
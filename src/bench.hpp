@@ -1,12 +1,22 @@
 #pragma once
 
 #include <algorithm>
-#include <cassert>
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <cstdio>
 #include <flat_map>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <span>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <tuple>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -27,6 +37,11 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include "ConcurrentTwoWay.hpp"
+#include "QuotientTwoWay.hpp"
+#include "ShardedTwoWay.hpp"
+#include "StaticTwoWay.hpp"
+#include "StringTwoWay.hpp"
 #include "TwoWay.hpp"
 #include "boost_unordered.hpp"
 #include "dynamic_fph_table.hpp"
@@ -36,8 +51,38 @@ struct BenchResult {
     PerfCounters counter;
     uint64_t sum;
     uint64_t lookups;
+    // Wall time per key of building the map the lookups ran against.
+    double build_ns = 0.0;
+    // TwoWay::stats() of that map; empty for the other maps.
+    stats::Occupancy occupancy{};
 };
 
+inline double ns_per_key_since(std::chrono::steady_clock::time_point start, size_t keys) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    return static_cast<double>(ns) / static_cast<double>(keys);
+}
+
+inline double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+// `lookup_fn` either resolves one key, `(uint64_t key) -> uint64_t`, or a whole batch at once,
+// `(std::span<const uint64_t> batch) -> uint64_t`.
+inline uint64_t run_batch(const uint64_t* batch, size_t batch_size, auto&& lookup_fn) {
+    if constexpr (std::is_invocable_v<decltype(lookup_fn), std::span<const uint64_t>>) {
+        return lookup_fn(std::span<const uint64_t>{batch, batch_size});
+    } else {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < batch_size; i++) {
+            sum += lookup_fn(batch[i]);
+        }
+        return sum;
+    }
+}
+
 inline std::tuple<PerfCounters, uint64_t> benchmark_batch(
     std::span<const uint64_t> lookups,
     size_t batch_size,
@@ -46,20 +91,16 @@ inline std::tuple<PerfCounters, uint64_t> benchmark_batch(
     PerfCounterSet counter_set,
     size_t warmup_iters = 1) {
     uint64_t sum = 0;
-    uint64_t steps = 0;
     size_t offset = 0;
 
     if (warmup_iters > 0) {
         size_t warmup_rounds = std::min(warmup_iters, iters);
         size_t warmup_offset = 0;
         volatile uint64_t warmup_sum = 0;
-        uint64_t warmup_steps = 0;
         for (size_t iter = 0; iter < warmup_rounds; iter++) {
             const auto* batch = &lookups[warmup_offset];
             warmup_offset += batch_size;
-            for (size_t i = 0; i < batch_size; i++) {
-                warmup_sum += lookup_fn(batch[i], &warmup_steps);
-            }
+            warmup_sum = warmup_sum + run_batch(batch, batch_size, lookup_fn);
         }
     }
 
@@ -69,9 +110,7 @@ inline std::tuple<PerfCounters, uint64_t> benchmark_batch(
     for (size_t iter = 0; iter < iters; iter++) {
         const auto* batch = &lookups[offset];
         offset += batch_size;
-        for (size_t i = 0; i < batch_size; i++) {
-            sum += lookup_fn(batch[i], &steps);
-        }
+        sum += run_batch(batch, batch_size, lookup_fn);
     }
     const auto end = RECORDER.get_counters(counter_set);
     RECORDER.disable_all();
@@ -106,79 +145,709 @@ struct U64ToU64TableTrait {
     using Key = uint64_t;
     using Value = uint64_t;
 
-    static uint64_t hash(Key key) {
+    static constexpr uint64_t hash(Key key) {
         return squirrel3(key);
     }
 };
 
+struct U32ToU32TableTrait {
+    using Key = uint32_t;
+    using Value = uint32_t;
+
+    static constexpr uint64_t hash(Key key) {
+        return squirrel3(key);
+    }
+};
+
+// Bytes currently allocated through CountingAllocator, the footprint of containers that do not
+// report their own.
+inline uint64_t counted_bytes = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        counted_bytes += n * sizeof(T);
+        return std::allocator<T>{}.allocate(n);
+    }
+    void deallocate(T* p, size_t n) {
+        counted_bytes -= n * sizeof(T);
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>&) const {
+        return true;
+    }
+};
+
+struct StringToU64TableTrait {
+    using Value = uint64_t;
+
+    static uint64_t hash(std::string_view key) {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
 } // namespace detail
 
 inline std::vector<BenchResult> benchmark_boost(
     std::span<const uint64_t> keys,
     std::span<const std::vector<uint64_t>> lookup_sets,
     size_t iters) {
+    const auto start = std::chrono::steady_clock::now();
     boost::unordered::unordered_flat_map<uint64_t, uint64_t> map{};
     map.reserve(keys.size() * 2);
     for (const auto key : keys) {
         map.emplace(key, key);
     }
+    const auto build_ns = ns_per_key_since(start, keys.size());
 
     auto results = std::vector<BenchResult>{};
     results.reserve(lookup_sets.size());
 
     for (const auto& lookups : lookup_sets) {
-        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key, uint64_t*) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
             const auto it = map.find(key);
-            assert(it != map.end());
-            return it->second;
+            return it == map.end() ? 0 : it->second;
         }));
     }
 
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+    }
+
     return results;
 }
 
+template <typename Map>
 inline std::vector<BenchResult> benchmark_twoway(
     std::span<const uint64_t> keys,
     std::span<const std::vector<uint64_t>> lookup_sets,
     size_t iters) {
-    TwoWay<detail::U64ToU64TableTrait, 4> twoway{};
+    std::vector<std::pair<typename Map::Key, typename Map::Value>> entries{};
+    entries.reserve(keys.size());
     for (const auto key : keys) {
-        twoway.insert(key, key);
+        entries.emplace_back(key, key);
     }
+    const auto start = std::chrono::steady_clock::now();
+    Map twoway{std::span<const std::pair<typename Map::Key, typename Map::Value>>{entries}};
+    const auto build_ns = ns_per_key_since(start, keys.size());
 
     auto results = std::vector<BenchResult>{};
     results.reserve(lookup_sets.size());
 
     for (const auto& lookups : lookup_sets) {
-        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key, uint64_t* steps) {
-            return twoway.find(key, steps);
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
+            const auto* value = twoway.find_ptr(key);
+            return value == nullptr ? 0 : *value;
         }));
     }
 
+    const auto occupancy = twoway.stats();
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+        result.occupancy = occupancy;
+    }
+
     return results;
 }
 
+template <typename Map>
+inline std::vector<BenchResult> benchmark_twoway_batch(
+    std::span<const uint64_t> keys,
+    std::span<const std::vector<uint64_t>> lookup_sets,
+    size_t iters) {
+    std::vector<std::pair<typename Map::Key, typename Map::Value>> entries{};
+    entries.reserve(keys.size());
+    for (const auto key : keys) {
+        entries.emplace_back(key, key);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    Map twoway{std::span<const std::pair<typename Map::Key, typename Map::Value>>{entries}};
+    const auto build_ns = ns_per_key_since(start, keys.size());
+
+    auto results = std::vector<BenchResult>{};
+    results.reserve(lookup_sets.size());
+
+    std::vector<uint64_t> values{};
+    for (const auto& lookups : lookup_sets) {
+        values.resize(lookups.size() / iters);
+        results.emplace_back(
+            benchmark_split(lookups, iters, [&](std::span<const uint64_t> batch) {
+                twoway.find_many(batch, std::span<uint64_t>{values});
+                uint64_t sum = 0;
+                for (const auto value : values) {
+                    sum += value;
+                }
+                return sum;
+            }));
+    }
+
+    const auto occupancy = twoway.stats();
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+        result.occupancy = occupancy;
+    }
+
+    return results;
+}
+
+// Load factor a TwoWay had right before its last (largest) grow while inserting `keys`, i.e.
+// the load at which that table size ran out of room.
+template <typename Map>
+inline double max_load_factor(std::span<const uint64_t> keys, uint64_t max_kicks) {
+    Map twoway{};
+    twoway.max_kicks = max_kicks;
+    double load_at_grow = 0.0;
+    for (const auto key : keys) {
+        const auto capacity = twoway.capacity;
+        const auto load = twoway.load_factor();
+        twoway.insert(
+            static_cast<typename Map::Key>(key), static_cast<typename Map::Value>(key));
+        if (twoway.capacity != capacity) {
+            load_at_grow = load;
+        }
+    }
+    return load_at_grow;
+}
+
+struct BucketSweep {
+    BenchResult lookup;
+    double max_load;
+    double bytes_per_entry;
+};
+
+// One point of the bucket width sweep: lookups over `keys` plus the load factor and memory per
+// entry the same Map reaches holding them. Keys are narrowed to Map::Key.
+template <typename Map>
+inline BucketSweep benchmark_bucket_width(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups,
+    size_t iters) {
+    using Key = typename Map::Key;
+    Map twoway{};
+    for (const auto key : keys) {
+        twoway.insert(static_cast<Key>(key), static_cast<typename Map::Value>(key));
+    }
+    auto lookup = benchmark_split(lookups, iters, [&](uint64_t key) {
+        const auto* value = twoway.find_ptr(static_cast<Key>(key));
+        return value == nullptr ? uint64_t{0} : uint64_t{*value};
+    });
+    const auto bytes_per_entry =
+        static_cast<double>(twoway.memory_usage()) / static_cast<double>(twoway.size());
+    return {lookup, max_load_factor<Map>(keys, twoway.max_kicks), bytes_per_entry};
+}
+
+struct KeyCompression {
+    BenchResult lookup;
+    double load_factor;
+    double bytes_per_entry;
+};
+
+// Lookups over `keys` in a Map filled with them one by one, next to the load it ended at and its
+// memory per entry. For TwoWay and QuotientTwoWay alike.
+template <typename Map>
+inline KeyCompression benchmark_key_compression(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups,
+    size_t iters) {
+    Map map{};
+    for (const auto key : keys) {
+        map.insert(key, key);
+    }
+    auto lookup = benchmark_split(lookups, iters, [&](uint64_t key) {
+        const auto* value = map.find_ptr(key);
+        return value == nullptr ? 0 : *value;
+    });
+    return {
+        lookup,
+        map.load_factor(),
+        static_cast<double>(map.memory_usage()) / static_cast<double>(map.size()),
+    };
+}
+
+struct ProbeSweep {
+    stats::Probes probes;
+    stats::Occupancy occupancy;
+};
+
+// Where `lookups` end up in a TwoWay holding `keys`, recorded by its stats::Probes policy, next
+// to what stats() says about the same map. Keys are narrowed to Map::Key.
+template <typename Map>
+inline ProbeSweep benchmark_probe_stats(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups) {
+    using Key = typename Map::Key;
+    Map twoway{};
+    for (const auto key : keys) {
+        twoway.insert(static_cast<Key>(key), static_cast<typename Map::Value>(key));
+    }
+    twoway.probe_stats.clear();
+    volatile bool sink = false;
+    for (const auto key : lookups) {
+        sink = twoway.contains(static_cast<Key>(key));
+    }
+    (void)sink;
+    return {twoway.probe_stats, twoway.stats()};
+}
+
+struct InsertLatency {
+    uint64_t max_ns;
+    uint64_t p999_ns;
+};
+
+// Wall time of every single insert while filling a TwoWay with `keys`, so grows land in the tail.
+template <typename Map>
+inline InsertLatency benchmark_insert_latency(
+    std::span<const uint64_t> keys,
+    uint64_t migrate_step) {
+    Map twoway{};
+    twoway.migrate_step = migrate_step;
+    std::vector<uint64_t> latencies{};
+    latencies.reserve(keys.size());
+    for (const auto key : keys) {
+        const auto start = std::chrono::steady_clock::now();
+        twoway.insert(key, key);
+        const auto end = std::chrono::steady_clock::now();
+        latencies.emplace_back(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+    }
+    std::sort(latencies.begin(), latencies.end());
+    return {latencies.back(), latencies[latencies.size() * 999 / 1000]};
+}
+
+struct GrowthCost {
+    double insert_ns;
+    double bytes_per_entry;
+};
+
+// Fills a TwoWay growing by `growth` with `keys` (after reserve(keys.size()) if `reserve`):
+// wall time per insert and memory per entry once all keys are in.
+template <typename Map>
+inline GrowthCost benchmark_growth(std::span<const uint64_t> keys, double growth, bool reserve) {
+    Map twoway{};
+    twoway.growth = growth;
+    const auto start = std::chrono::steady_clock::now();
+    if (reserve) {
+        twoway.reserve(keys.size());
+    }
+    for (const auto key : keys) {
+        twoway.insert(key, key);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return {
+        static_cast<double>(ns) / static_cast<double>(keys.size()),
+        static_cast<double>(twoway.memory_usage()) / static_cast<double>(twoway.size()),
+    };
+}
+
+struct StartupCost {
+    double rebuild_ms;
+    double mapped_ms;
+    double verified_ms;
+};
+
+// Time from nothing to the first answered lookup: rebuilding the map from `keys` with the bulk
+// constructor, versus open_mapped() on a snapshot of it, without and with checksum verification.
+// The snapshot is saved to `path` beforehand and removed afterwards; it sits in the page cache.
+// If saving or mapping it fails, the snapshot timings are NaN and the error goes to stderr.
+template <typename Map>
+inline StartupCost benchmark_startup(std::span<const uint64_t> keys, const char* path) {
+    using Entry = std::pair<typename Map::Key, typename Map::Value>;
+    std::vector<Entry> entries{};
+    entries.reserve(keys.size());
+    for (const auto key : keys) {
+        entries.emplace_back(key, key);
+    }
+    const auto probe = keys[keys.size() / 2];
+
+    const auto start = std::chrono::steady_clock::now();
+    Map rebuilt{std::span<const Entry>{entries}};
+    volatile uint64_t sink = rebuilt.find(probe);
+    const auto rebuild_ms = ms_since(start);
+    constexpr double FAILED = std::numeric_limits<double>::quiet_NaN();
+    if (!rebuilt.save(path)) {
+        std::fprintf(stderr, "benchmark_startup: cannot save snapshot to %s\n", path);
+        std::remove(path);
+        return {rebuild_ms, FAILED, FAILED};
+    }
+
+    auto open_ms = [&](bool verify) {
+        const auto open_start = std::chrono::steady_clock::now();
+        auto mapped = Map::open_mapped(path, verify);
+        if (mapped == nullptr) {
+            std::fprintf(stderr, "benchmark_startup: cannot open snapshot %s\n", path);
+            return FAILED;
+        }
+        sink = sink + mapped->find(probe);
+        return ms_since(open_start);
+    };
+    const auto mapped_ms = open_ms(false);
+    const auto verified_ms = open_ms(true);
+    std::remove(path);
+    return {rebuild_ms, mapped_ms, verified_ms};
+}
+
+// Counting occurrences: every key of `stream` (which repeats keys) bumps its count in an
+// initially empty Map through `bump(map, key)`. Wall time per increment.
+template <typename Map>
+inline double benchmark_counter(std::span<const uint64_t> stream, auto&& bump) {
+    Map map{};
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto key : stream) {
+        bump(map, key);
+    }
+    const auto ns = ns_per_key_since(start, stream.size());
+    volatile uint64_t sink = map.size();
+    (void)sink;
+    return ns;
+}
+
+// Wall time per lookup of `lookups` against `map`, anything with find_ptr().
+inline double benchmark_find_ns(auto& map, std::span<const uint64_t> lookups) {
+    uint64_t sum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto key : lookups) {
+        const auto* value = map.find_ptr(key);
+        sum += value == nullptr ? 0 : *value;
+    }
+    const auto ns = ns_per_key_since(start, lookups.size());
+    volatile uint64_t sink = sum;
+    (void)sink;
+    return ns;
+}
+
+struct RuntimeBuilt {
+    double build_us;
+    double lookup_ns;
+};
+
+// The runtime counterpart of a static table: a Map built from `entries` with insert() or, if
+// `bulk`, the bulk constructor. Microseconds to build it, then the same lookups.
+template <typename Map>
+inline RuntimeBuilt benchmark_runtime_built(
+    std::span<const std::pair<uint64_t, uint64_t>> entries,
+    std::span<const uint64_t> lookups,
+    bool bulk) {
+    const auto start = std::chrono::steady_clock::now();
+    auto map = bulk ? std::make_unique<Map>(entries) : std::make_unique<Map>();
+    if (!bulk) {
+        for (const auto& [key, value] : entries) {
+            map->insert(key, value);
+        }
+    }
+    const auto build_us = ms_since(start) * 1000.0;
+    return {build_us, benchmark_find_ns(*map, lookups)};
+}
+
+struct Membership {
+    double lookup_ns;
+    double bytes_per_entry;
+};
+
+// Wall time per lookup of `lookups` against a Set filled with `keys` through insert(set, key),
+// and the bytes per key it occupies. `footprint(set, allocated)` reports the latter given the
+// bytes CountingAllocator handed out while the set was built.
+template <typename Set>
+inline Membership benchmark_membership(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups,
+    auto&& insert,
+    auto&& footprint) {
+    const auto before = detail::counted_bytes;
+    Set set{};
+    for (const auto key : keys) {
+        insert(set, key);
+    }
+    const auto bytes = footprint(set, detail::counted_bytes - before);
+    uint64_t hits = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto key : lookups) {
+        hits += set.contains(key);
+    }
+    const auto ns = ns_per_key_since(start, lookups.size());
+    volatile uint64_t sink = hits;
+    (void)sink;
+    return {ns, static_cast<double>(bytes) / static_cast<double>(keys.size())};
+}
+
+// Wall time per entry of `sum()` visiting all `entries` of a map, repeated so every size scans
+// about 16M entries in total.
+inline double scan_ns_per_entry(size_t entries, auto&& sum) {
+    const size_t rounds = std::max<size_t>(1, (size_t{1} << 24) / entries);
+    volatile uint64_t sink = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; round++) {
+        sink = sink + sum();
+    }
+    return ns_per_key_since(start, entries * rounds);
+}
+
+// Full-table scans summing every value, built from `keys` mapped to themselves.
+template <typename Map>
+inline double benchmark_twoway_scan(std::span<const uint64_t> keys) {
+    Map twoway{};
+    for (const auto key : keys) {
+        twoway.insert(key, key);
+    }
+    return scan_ns_per_entry(keys.size(), [&] { return twoway.sum_all_values(); });
+}
+
+template <typename Map>
+inline double benchmark_twoway_for_each(std::span<const uint64_t> keys) {
+    Map twoway{};
+    for (const auto key : keys) {
+        twoway.insert(key, key);
+    }
+    return scan_ns_per_entry(keys.size(), [&] {
+        uint64_t sum = 0;
+        twoway.for_each([&](const auto&, const auto& value) { sum += value; });
+        return sum;
+    });
+}
+
+// Range-for over any node or flat map with reserve/emplace (boost, absl, std).
+template <typename Map>
+inline double benchmark_map_scan(std::span<const uint64_t> keys) {
+    Map map{};
+    map.reserve(keys.size() * 2);
+    for (const auto key : keys) {
+        map.emplace(key, key);
+    }
+    return scan_ns_per_entry(keys.size(), [&] {
+        uint64_t sum = 0;
+        for (const auto& [key, value] : map) {
+            sum += value;
+        }
+        return sum;
+    });
+}
+
+// flat_map keeps its values in one contiguous vector, the best case for any scan.
+inline double benchmark_flat_map_scan(std::span<const uint64_t> keys) {
+    std::vector<uint64_t> sorted{keys.begin(), keys.end()};
+    std::sort(sorted.begin(), sorted.end());
+    std::flat_map<uint64_t, uint64_t> map{std::sorted_unique, sorted, sorted};
+    return scan_ns_per_entry(keys.size(), [&] {
+        uint64_t sum = 0;
+        for (const auto value : map.values()) {
+            sum += value;
+        }
+        return sum;
+    });
+}
+
+// Wall time of `threads` threads running `work(t)` at once, from a common start signal.
+inline uint64_t run_parallel_ns(size_t threads, auto&& work) {
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> workers{};
+    workers.reserve(threads);
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            work(t);
+        });
+    }
+    while (ready.load() != threads) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+// Wall time per lookup with `threads` threads resolving their own slice of `lookups` at once.
+inline double parallel_lookup_ns(
+    std::span<const uint64_t> lookups,
+    size_t threads,
+    auto&& lookup_fn) {
+    const auto per_thread = lookups.size() / threads;
+    std::atomic<uint64_t> sum{0};
+    const auto ns = run_parallel_ns(threads, [&](size_t t) {
+        uint64_t local_sum = 0;
+        for (const auto key : lookups.subspan(t * per_thread, per_thread)) {
+            local_sum += lookup_fn(key);
+        }
+        sum.fetch_add(local_sum, std::memory_order_relaxed);
+    });
+    volatile uint64_t sink = sum.load();
+    (void)sink;
+    return static_cast<double>(ns) / static_cast<double>(per_thread * threads);
+}
+
+// Million inserts per second with `threads` threads each inserting its own slice of `keys`
+// into one shared, initially empty map through `insert_fn(map, slice)`.
+template <typename Map>
+inline double parallel_insert_mops(
+    std::span<const uint64_t> keys,
+    size_t threads,
+    auto&& insert_fn) {
+    Map map{};
+    const auto per_thread = keys.size() / threads;
+    const auto ns = run_parallel_ns(threads, [&](size_t t) {
+        insert_fn(map, keys.subspan(t * per_thread, per_thread));
+    });
+    return static_cast<double>(per_thread * threads) * 1000.0 / static_cast<double>(ns);
+}
+
+// Writers inserting one key at a time.
+template <typename Map>
+inline double benchmark_sharded_insert(std::span<const uint64_t> keys, size_t threads) {
+    return parallel_insert_mops<Map>(keys, threads, [](Map& map, std::span<const uint64_t> slice) {
+        for (const auto key : slice) {
+            map.insert(key, key);
+        }
+    });
+}
+
+// Writers inserting through insert_many, BATCH keys per call.
+template <typename Map, size_t BATCH = 256>
+inline double benchmark_sharded_insert_many(std::span<const uint64_t> keys, size_t threads) {
+    return parallel_insert_mops<Map>(keys, threads, [](Map& map, std::span<const uint64_t> slice) {
+        for (size_t i = 0; i < slice.size(); i += BATCH) {
+            const auto batch = slice.subspan(i, std::min(BATCH, slice.size() - i));
+            map.insert_many(batch, batch);
+        }
+    });
+}
+
+// Million entries per second loading `keys` into a TwoWay pre-sized to about half load through
+// build() with `threads` threads.
+template <typename Map>
+inline double benchmark_build(std::span<const uint64_t> keys, size_t threads) {
+    std::vector<std::pair<uint64_t, uint64_t>> entries{};
+    entries.reserve(keys.size());
+    for (const auto key : keys) {
+        entries.emplace_back(key, key);
+    }
+    Map map{2 * keys.size() / Map::BUCKET_LANES};
+    const auto start = std::chrono::steady_clock::now();
+    map.build(entries, threads);
+    const auto end = std::chrono::steady_clock::now();
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return static_cast<double>(keys.size()) * 1000.0 / static_cast<double>(ns);
+}
+
+// Million entries per second inserting `keys` one by one into a default (growing) TwoWay.
+template <typename Map>
+inline double benchmark_serial_insert(std::span<const uint64_t> keys) {
+    Map map{};
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto key : keys) {
+        map.insert(key, key);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    return static_cast<double>(keys.size()) * 1000.0 / static_cast<double>(ns);
+}
+
+// The single-writer baseline: one TwoWay behind one mutex.
+template <typename Map>
+inline double benchmark_locked_twoway_insert(std::span<const uint64_t> keys, size_t threads) {
+    struct Locked {
+        std::mutex mutex;
+        Map map;
+    };
+    return parallel_insert_mops<Locked>(
+        keys, threads, [](Locked& locked, std::span<const uint64_t> slice) {
+            for (const auto key : slice) {
+                std::lock_guard lock{locked.mutex};
+                locked.map.insert(key, key);
+            }
+        });
+}
+
+template <typename Map>
+inline double benchmark_concurrent_twoway(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups,
+    size_t threads) {
+    Map twoway{};
+    for (const auto key : keys) {
+        twoway.insert(key, key);
+    }
+    return parallel_lookup_ns(lookups, threads, [&](uint64_t key) {
+        const auto value = twoway.find(key);
+        return value ? *value : 0;
+    });
+}
+
+// A plain TwoWay shared by all threads. Only safe because nothing writes during the run, this
+// is the upper bound for what the concurrent variant's version checks cost.
+template <typename Map>
+inline double benchmark_shared_twoway(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups,
+    size_t threads) {
+    Map twoway{};
+    for (const auto key : keys) {
+        twoway.insert(key, key);
+    }
+    return parallel_lookup_ns(lookups, threads, [&](uint64_t key) {
+        const auto* value = twoway.find_ptr(key);
+        return value == nullptr ? 0 : *value;
+    });
+}
+
+inline double benchmark_boost_shared_mutex(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups,
+    size_t threads) {
+    boost::unordered::unordered_flat_map<uint64_t, uint64_t> map{};
+    map.reserve(keys.size() * 2);
+    for (const auto key : keys) {
+        map.emplace(key, key);
+    }
+    std::shared_mutex mutex{};
+    return parallel_lookup_ns(lookups, threads, [&](uint64_t key) {
+        std::shared_lock lock{mutex};
+        const auto it = map.find(key);
+        return it == map.end() ? 0 : it->second;
+    });
+}
+
 inline std::vector<BenchResult> benchmark_absl_flat_hash_map(
     std::span<const uint64_t> keys,
     std::span<const std::vector<uint64_t>> lookup_sets,
     size_t iters) {
+    const auto start = std::chrono::steady_clock::now();
     absl::flat_hash_map<uint64_t, uint64_t> map{};
     map.reserve(keys.size() * 2);
     for (const auto key : keys) {
         map.emplace(key, key);
     }
+    const auto build_ns = ns_per_key_since(start, keys.size());
 
     auto results = std::vector<BenchResult>{};
     results.reserve(lookup_sets.size());
 
     for (const auto& lookups : lookup_sets) {
-        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key, uint64_t*) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
             const auto it = map.find(key);
-            assert(it != map.end());
-            return it->second;
+            return it == map.end() ? 0 : it->second;
         }));
     }
 
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+    }
+
     return results;
 }
 
@@ -186,23 +855,28 @@ inline std::vector<BenchResult> benchmark_dynamic_fph_map(
     std::span<const uint64_t> keys,
     std::span<const std::vector<uint64_t>> lookup_sets,
     size_t iters) {
+    const auto start = std::chrono::steady_clock::now();
     fph::DynamicFphMap<uint64_t, uint64_t> map{};
     map.reserve(keys.size() * 2);
     for (const auto key : keys) {
         map.emplace(key, key);
     }
+    const auto build_ns = ns_per_key_since(start, keys.size());
 
     auto results = std::vector<BenchResult>{};
     results.reserve(lookup_sets.size());
 
     for (const auto& lookups : lookup_sets) {
-        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key, uint64_t*) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
             const auto it = map.find(key);
-            assert(it != map.end());
-            return it->second;
+            return it == map.end() ? 0 : it->second;
         }));
     }
 
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+    }
+
     return results;
 }
 
@@ -210,23 +884,28 @@ inline std::vector<BenchResult> benchmark_std_unordered_map(
     std::span<const uint64_t> keys,
     std::span<const std::vector<uint64_t>> lookup_sets,
     size_t iters) {
+    const auto start = std::chrono::steady_clock::now();
     std::unordered_map<uint64_t, uint64_t> map{};
     map.reserve(keys.size() * 2);
     for (const auto key : keys) {
         map.emplace(key, key);
     }
+    const auto build_ns = ns_per_key_since(start, keys.size());
 
     auto results = std::vector<BenchResult>{};
     results.reserve(lookup_sets.size());
 
     for (const auto& lookups : lookup_sets) {
-        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key, uint64_t*) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
             const auto it = map.find(key);
-            assert(it != map.end());
-            return it->second;
+            return it == map.end() ? 0 : it->second;
         }));
     }
 
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+    }
+
     return results;
 }
 
@@ -240,16 +919,71 @@ inline std::vector<BenchResult> benchmark_std_flat_map(
         items.emplace_back(key, key);
     }
 
+    const auto start = std::chrono::steady_clock::now();
     std::flat_map<uint64_t, uint64_t> map{std::sorted_unique, items.begin(), items.end()};
+    const auto build_ns = ns_per_key_since(start, keys.size());
 
     auto results = std::vector<BenchResult>{};
     results.reserve(lookup_sets.size());
 
     for (const auto& lookups : lookup_sets) {
-        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key, uint64_t*) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
             const auto it = map.find(key);
-            assert(it != map.end());
-            return it->second;
+            return it == map.end() ? 0 : it->second;
+        }));
+    }
+
+    for (auto& result : results) {
+        result.build_ns = build_ns;
+    }
+
+    return results;
+}
+
+// String keys: `strings[i]` maps to i + 1 and the lookups are the usual 1-based integer keys, so
+// the lookup sets are shared with the integer benchmarks and key i is probed as strings[i - 1].
+template <typename Map>
+inline std::vector<BenchResult> benchmark_string_twoway(
+    std::span<const std::string> strings,
+    std::span<const std::vector<uint64_t>> lookup_sets,
+    size_t iters) {
+    Map twoway{};
+    for (uint64_t i = 0; i < strings.size(); i++) {
+        twoway.insert(strings[i], i + 1);
+    }
+
+    auto results = std::vector<BenchResult>{};
+    results.reserve(lookup_sets.size());
+
+    for (const auto& lookups : lookup_sets) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
+            const auto* value = twoway.find_ptr(strings[key - 1]);
+            return value == nullptr ? 0 : *value;
+        }));
+    }
+
+    return results;
+}
+
+// Same as benchmark_string_twoway for any map keyed by std::string (boost, absl, std).
+template <typename Map>
+inline std::vector<BenchResult> benchmark_string_map(
+    std::span<const std::string> strings,
+    std::span<const std::vector<uint64_t>> lookup_sets,
+    size_t iters) {
+    Map map{};
+    map.reserve(strings.size() * 2);
+    for (uint64_t i = 0; i < strings.size(); i++) {
+        map.emplace(strings[i], i + 1);
+    }
+
+    auto results = std::vector<BenchResult>{};
+    results.reserve(lookup_sets.size());
+
+    for (const auto& lookups : lookup_sets) {
+        results.emplace_back(benchmark_split(lookups, iters, [&](uint64_t key) {
+            const auto it = map.find(strings[key - 1]);
+            return it == map.end() ? 0 : it->second;
         }));
     }
 
@@ -0,0 +1,250 @@
+#pragma once
+
+#include "base.hpp"
+#include "simd.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <type_traits>
+
+// Bucket storage layouts for TwoWay. Each layout provides `Buckets<Key, Value, BUCKET>`, a
+// handle to one array of buckets that TwoWay allocates, probes and frees; it owns no memory
+// by itself so generations can be swapped and copied around freely.
+//
+// `sum(bucket, mask)` adds up the values of the lanes set in `mask`, the kernel of full-table
+// scans.
+//
+// For snapshots, `regions(count, f)` hands every raw array to f(memory, bytes) in a fixed
+// order and `adopt(count, take)` points the handle at memory returned by take(bytes) in that
+// same order. ID tells the layouts apart in a snapshot header.
+namespace layout {
+
+// One struct per bucket holding all of its keys followed by all of its values.
+struct Split {
+    static constexpr uint32_t ID = 1;
+
+    template <typename Key, typename Value, uint64_t BUCKET>
+    struct Buckets {
+        struct Slot {
+            Key keys[BUCKET];
+            Value values[BUCKET];
+        };
+
+        static constexpr uint64_t BYTES_PER_BUCKET = sizeof(Slot);
+
+        void allocate(uint64_t count) {
+            slots = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * count));
+        }
+        void release() {
+            __aligned_free(slots);
+            slots = nullptr;
+        }
+        explicit operator bool() const {
+            return slots != nullptr;
+        }
+
+        Key& key(uint64_t bucket, uint64_t lane) const {
+            return slots[bucket].keys[lane];
+        }
+        Value& value(uint64_t bucket, uint64_t lane) const {
+            return slots[bucket].values[lane];
+        }
+        uint64_t match(uint64_t bucket, Key needle) const {
+            return simd::match<Key, BUCKET>(slots[bucket].keys, needle);
+        }
+        void prefetch(uint64_t bucket) const {
+            ::prefetch(slots[bucket].keys);
+            ::prefetch(slots[bucket].values);
+        }
+        Value sum(uint64_t bucket, uint64_t mask) const {
+            return simd::masked_sum<Value, BUCKET>(slots[bucket].values, mask);
+        }
+
+        void regions(uint64_t count, auto&& f) const {
+            f(slots, sizeof(Slot) * count);
+        }
+        void adopt(uint64_t count, auto&& take) {
+            slots = reinterpret_cast<Slot*>(take(sizeof(Slot) * count));
+        }
+
+        Slot* slots = nullptr;
+    };
+};
+
+// Key/value pairs side by side, so a hit finds its value on the line of its key.
+struct Interleaved {
+    static constexpr uint32_t ID = 2;
+
+    template <typename Key, typename Value, uint64_t BUCKET>
+    struct Buckets {
+        struct Pair {
+            Key key;
+            Value value;
+        };
+        struct Slot {
+            Pair pairs[BUCKET];
+        };
+
+        static constexpr uint64_t BYTES_PER_BUCKET = sizeof(Slot);
+
+        void allocate(uint64_t count) {
+            slots = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * count));
+        }
+        void release() {
+            __aligned_free(slots);
+            slots = nullptr;
+        }
+        explicit operator bool() const {
+            return slots != nullptr;
+        }
+
+        Key& key(uint64_t bucket, uint64_t lane) const {
+            return slots[bucket].pairs[lane].key;
+        }
+        Value& value(uint64_t bucket, uint64_t lane) const {
+            return slots[bucket].pairs[lane].value;
+        }
+        uint64_t match(uint64_t bucket, Key needle) const {
+            if constexpr (sizeof(Pair) == 2 * sizeof(Key) && 2 * BUCKET < 64) {
+                // Compare the pairs as 2 * BUCKET key-sized lanes and keep the key lanes.
+                const Key* lanes = &slots[bucket].pairs[0].key;
+                return simd::even_lanes(simd::match<Key, 2 * BUCKET>(lanes, needle));
+            } else {
+                uint64_t mask = 0;
+                for (uint64_t i = 0; i < BUCKET; i++)
+                    mask |= static_cast<uint64_t>(slots[bucket].pairs[i].key == needle) << i;
+                return mask;
+            }
+        }
+        void prefetch(uint64_t bucket) const {
+            ::prefetch(&slots[bucket]);
+        }
+        Value sum(uint64_t bucket, uint64_t mask) const {
+            Value sum{};
+            for (; mask; mask &= mask - 1)
+                sum += slots[bucket].pairs[static_cast<uint64_t>(std::countr_zero(mask))].value;
+            return sum;
+        }
+
+        void regions(uint64_t count, auto&& f) const {
+            f(slots, sizeof(Slot) * count);
+        }
+        void adopt(uint64_t count, auto&& take) {
+            slots = reinterpret_cast<Slot*>(take(sizeof(Slot) * count));
+        }
+
+        Slot* slots = nullptr;
+    };
+};
+
+// All keys in one array and all values in another, so key scans never pull values into cache.
+struct Separate {
+    static constexpr uint32_t ID = 3;
+
+    template <typename Key, typename Value, uint64_t BUCKET>
+    struct Buckets {
+        static constexpr uint64_t BYTES_PER_BUCKET = (sizeof(Key) + sizeof(Value)) * BUCKET;
+
+        void allocate(uint64_t count) {
+            keys = reinterpret_cast<Key*>(
+                __aligned_alloc(CACHE_LINE, sizeof(Key) * BUCKET * count));
+            values = reinterpret_cast<Value*>(
+                __aligned_alloc(CACHE_LINE, sizeof(Value) * BUCKET * count));
+        }
+        void release() {
+            __aligned_free(keys);
+            __aligned_free(values);
+            keys = nullptr;
+            values = nullptr;
+        }
+        explicit operator bool() const {
+            return keys != nullptr;
+        }
+
+        Key& key(uint64_t bucket, uint64_t lane) const {
+            return keys[bucket * BUCKET + lane];
+        }
+        Value& value(uint64_t bucket, uint64_t lane) const {
+            return values[bucket * BUCKET + lane];
+        }
+        uint64_t match(uint64_t bucket, Key needle) const {
+            return simd::match<Key, BUCKET>(&keys[bucket * BUCKET], needle);
+        }
+        void prefetch(uint64_t bucket) const {
+            ::prefetch(&keys[bucket * BUCKET]);
+            ::prefetch(&values[bucket * BUCKET]);
+        }
+        Value sum(uint64_t bucket, uint64_t mask) const {
+            return simd::masked_sum<Value, BUCKET>(&values[bucket * BUCKET], mask);
+        }
+
+        void regions(uint64_t count, auto&& f) const {
+            f(keys, sizeof(Key) * BUCKET * count);
+            f(values, sizeof(Value) * BUCKET * count);
+        }
+        void adopt(uint64_t count, auto&& take) {
+            keys = reinterpret_cast<Key*>(take(sizeof(Key) * BUCKET * count));
+            values = reinterpret_cast<Value*>(take(sizeof(Value) * BUCKET * count));
+        }
+
+        Key* keys = nullptr;
+        Value* values = nullptr;
+    };
+};
+
+// Keys only, for sets: Value is an empty tag that is never stored, so a bucket is nothing but
+// its keys and a line-wide bucket holds twice as many keys as a Split one on the same line.
+struct KeysOnly {
+    static constexpr uint32_t ID = 4;
+
+    template <typename Key, typename Value, uint64_t BUCKET>
+    struct Buckets {
+        static_assert(std::is_empty_v<Value>, "KeysOnly has nowhere to store values");
+
+        struct Slot {
+            Key keys[BUCKET];
+        };
+
+        static constexpr uint64_t BYTES_PER_BUCKET = sizeof(Slot);
+
+        void allocate(uint64_t count) {
+            slots = reinterpret_cast<Slot*>(__aligned_alloc(CACHE_LINE, sizeof(Slot) * count));
+        }
+        void release() {
+            __aligned_free(slots);
+            slots = nullptr;
+        }
+        explicit operator bool() const {
+            return slots != nullptr;
+        }
+
+        Key& key(uint64_t bucket, uint64_t lane) const {
+            return slots[bucket].keys[lane];
+        }
+        // All lanes share one stateless value, so reads and writes through it are no-ops.
+        Value& value(uint64_t, uint64_t) const {
+            return none;
+        }
+        uint64_t match(uint64_t bucket, Key needle) const {
+            return simd::match<Key, BUCKET>(slots[bucket].keys, needle);
+        }
+        void prefetch(uint64_t bucket) const {
+            ::prefetch(slots[bucket].keys);
+        }
+        Value sum(uint64_t, uint64_t) const {
+            return Value{};
+        }
+
+        void regions(uint64_t count, auto&& f) const {
+            f(slots, sizeof(Slot) * count);
+        }
+        void adopt(uint64_t count, auto&& take) {
+            slots = reinterpret_cast<Slot*>(take(sizeof(Slot) * count));
+        }
+
+        static inline Value none{};
+        Slot* slots = nullptr;
+    };
+};
+
+} // namespace layout
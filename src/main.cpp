@@ -2,13 +2,16 @@
 #include <unistd.h>
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstdint>
+#include <filesystem>
 #include <format>
 #include <print>
 #include <random>
 #include <span>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -17,12 +20,47 @@
 constexpr auto ITERS = 100'000ULL;
 constexpr std::array<size_t, 8> BATCH_SIZE{1, 2, 4, 8, 16, 32, 64, 128};
 constexpr std::array<size_t, 5> NUM_KEYS_SHIFT{8, 10, 12, 14, 16};
+// Miss sections next to "Spare elements", which is the 0% case.
+constexpr std::array<uint64_t, 4> MISS_PERCENT{10, 50, 90, 100};
+constexpr std::array<uint64_t, 4> MAX_KICKS{0, 16, 64, 256};
+constexpr std::array<uint64_t, 4> MIGRATE_STEPS{0, 1, 4, 16};
+constexpr std::array<size_t, 3> LATENCY_KEYS_SHIFT{16, 20, 22};
+constexpr std::array<double, 3> GROWTH{2.0, 1.5, 1.25};
+constexpr std::array<size_t, 3> STARTUP_KEYS_SHIFT{16, 20, 23};
+constexpr std::array<size_t, 3> SCAN_KEYS_SHIFT{16, 20, 22};
+// Counter increments: COUNTER_OPS random draws from N distinct keys.
+constexpr std::array<size_t, 3> COUNTER_KEYS_SHIFT{10, 16, 20};
+constexpr size_t COUNTER_OPS = 1 << 22;
+// Membership: MEMBERSHIP_LOOKUPS random contains(), MEMBERSHIP_MISS_PERCENT% of them absent.
+constexpr std::array<size_t, 3> MEMBERSHIP_KEYS_SHIFT{16, 20, 22};
+constexpr size_t MEMBERSHIP_LOOKUPS = 1 << 22;
+constexpr uint64_t MEMBERSHIP_MISS_PERCENT = 50;
+// Static tables: keys 1..N placed at compile time, STATIC_LOOKUPS random hits.
+constexpr std::array<size_t, 3> STATIC_KEYS_SHIFT{8, 10, 12};
+constexpr size_t STATIC_LOOKUPS = 1 << 22;
+// Bucket width sweep: BUCKET = 2..16 for u32 and u64 keys, "(line)" marks the default.
+constexpr size_t SWEEP_BATCH = 16;
+// ~88% of 1 << 17 lanes, so bytes/entry shows which widths had to grow one more time.
+constexpr uint64_t SWEEP_KEYS = 115'000;
+constexpr uint64_t PROBE_MISS_PERCENT = 10;
+// Quotiented keys: the same keys 1..N in a TwoWay and in QuotientTwoWays bounded to 2^BITS.
+constexpr std::array<size_t, 3> QUOTIENT_KEYS_SHIFT{16, 20, 22};
+constexpr std::array<size_t, 4> READER_THREADS{1, 2, 4, 8};
+constexpr size_t INGEST_KEYS_SHIFT = 20;
+constexpr size_t BUILD_KEYS_SHIFT = 22;
+// String keys: 12 bytes fits every SSO buffer, 64 bytes always lives on the heap.
+constexpr size_t STRING_KEYS_SHIFT = 16;
+constexpr std::array<size_t, 2> STRING_KEY_BYTES{12, 64};
 
 namespace {
 struct BenchSet {
     size_t shift;
     std::vector<BenchResult> boost;
     std::vector<BenchResult> twoway;
+    std::vector<BenchResult> twoway_tags;
+    std::vector<BenchResult> twoway_batch;
+    std::vector<BenchResult> twoway_interleaved;
+    std::vector<BenchResult> twoway_separate;
     std::vector<BenchResult> absl;
     std::vector<BenchResult> fph;
     std::vector<BenchResult> std_map;
@@ -58,6 +96,30 @@ std::vector<std::vector<uint64_t>> make_random_lookup_sets(
     return lookup_sets;
 }
 
+// Random lookups where `miss_percent`% of the keys are absent (drawn from N+1..2N).
+std::vector<std::vector<uint64_t>> make_miss_lookup_sets(
+    std::span<const uint64_t> keys,
+    uint64_t miss_percent,
+    std::mt19937_64& rng) {
+    std::uniform_int_distribution<size_t> dist{0, keys.size() - 1};
+    std::uniform_int_distribution<uint64_t> percent{0, 99};
+
+    std::vector<std::vector<uint64_t>> lookup_sets{};
+    lookup_sets.reserve(BATCH_SIZE.size());
+    for (const auto batch_size : BATCH_SIZE) {
+        std::vector<uint64_t> lookups{};
+        const auto lookup_count = ITERS * batch_size;
+        lookups.reserve(lookup_count);
+        for (size_t i = 0; i < lookup_count; i++) {
+            const auto key = keys[dist(rng)];
+            lookups.emplace_back(percent(rng) < miss_percent ? key + keys.size() : key);
+        }
+        lookup_sets.emplace_back(std::move(lookups));
+    }
+
+    return lookup_sets;
+}
+
 std::vector<std::vector<uint64_t>> make_dense_lookup_sets(std::span<const uint64_t> keys) {
     std::vector<std::vector<uint64_t>> lookup_sets{};
     lookup_sets.reserve(BATCH_SIZE.size());
@@ -81,7 +143,13 @@ BenchSet run_benchmarks(
     return BenchSet{
         shift,
         benchmark_boost(keys, lookup_sets, ITERS),
-        benchmark_twoway(keys, lookup_sets, ITERS),
+        benchmark_twoway<TwoWay<detail::U64ToU64TableTrait, 4>>(keys, lookup_sets, ITERS),
+        benchmark_twoway<TwoWay<detail::U64ToU64TableTrait, 4, true>>(keys, lookup_sets, ITERS),
+        benchmark_twoway_batch<TwoWay<detail::U64ToU64TableTrait, 4>>(keys, lookup_sets, ITERS),
+        benchmark_twoway<TwoWay<detail::U64ToU64TableTrait, 4, false, layout::Interleaved>>(
+            keys, lookup_sets, ITERS),
+        benchmark_twoway<TwoWay<detail::U64ToU64TableTrait, 4, false, layout::Separate>>(
+            keys, lookup_sets, ITERS),
         benchmark_absl_flat_hash_map(keys, lookup_sets, ITERS),
         benchmark_dynamic_fph_map(keys, lookup_sets, ITERS),
         benchmark_std_unordered_map(keys, lookup_sets, ITERS),
@@ -99,6 +167,10 @@ void sink_results(const std::vector<BenchResult>& results) {
 void sink_all(const BenchSet& set) {
     sink_results(set.boost);
     sink_results(set.twoway);
+    sink_results(set.twoway_tags);
+    sink_results(set.twoway_batch);
+    sink_results(set.twoway_interleaved);
+    sink_results(set.twoway_separate);
     sink_results(set.absl);
     sink_results(set.fph);
     sink_results(set.std_map);
@@ -174,6 +246,34 @@ std::string format_cell(const BenchResult& result) {
     return std::format("{}/{}/{}/{}", cycles_per_lookup, branch_hit, l1d_hit, llc_hit);
 }
 
+void fit_widths(Table& table) {
+    table.widths.assign(table.headers.size(), 0);
+    for (size_t idx = 0; idx < table.headers.size(); idx++) {
+        table.widths[idx] = std::max(table.widths[idx], table.headers[idx].size());
+        for (const auto& row : table.rows) {
+            table.widths[idx] = std::max(table.widths[idx], row[idx].size());
+        }
+        table.widths[idx] += 2; // left + right padding
+    }
+}
+
+struct RowSpec {
+    std::string_view name;
+    const std::vector<BenchResult> BenchSet::* member;
+};
+constexpr std::array<RowSpec, 10> ROWS{{
+    {"boost", &BenchSet::boost},
+    {"twoway", &BenchSet::twoway},
+    {"twoway-tags", &BenchSet::twoway_tags},
+    {"twoway-batch", &BenchSet::twoway_batch},
+    {"twoway-interleaved", &BenchSet::twoway_interleaved},
+    {"twoway-separate", &BenchSet::twoway_separate},
+    {"absl", &BenchSet::absl},
+    {"fph", &BenchSet::fph},
+    {"std", &BenchSet::std_map},
+    {"flat", &BenchSet::flat},
+}};
+
 Table make_table(const BenchSet& set) {
     Table table;
     table.headers.emplace_back("kind");
@@ -181,20 +281,8 @@ Table make_table(const BenchSet& set) {
         table.headers.emplace_back(std::format("{}", batch_size));
     }
 
-    struct RowSpec {
-        std::string_view name;
-        const std::vector<BenchResult> BenchSet::* member;
-    };
-    constexpr std::array<RowSpec, 6> kRows{{
-        {"boost", &BenchSet::boost},
-        {"twoway", &BenchSet::twoway},
-        {"absl", &BenchSet::absl},
-        {"fph", &BenchSet::fph},
-        {"std", &BenchSet::std_map},
-        {"flat", &BenchSet::flat},
-    }};
 
-    for (const auto& row_spec : kRows) {
+    for (const auto& row_spec : ROWS) {
         const auto& results = set.*(row_spec.member);
         std::vector<std::string> row;
         row.reserve(table.headers.size());
@@ -205,15 +293,654 @@ Table make_table(const BenchSet& set) {
         table.rows.emplace_back(std::move(row));
     }
 
-    table.widths.assign(table.headers.size(), 0);
-    for (size_t idx = 0; idx < table.headers.size(); idx++) {
-        table.widths[idx] = std::max(table.widths[idx], table.headers[idx].size());
-        for (const auto& row : table.rows) {
-            table.widths[idx] = std::max(table.widths[idx], row[idx].size());
+    fit_widths(table);
+    return table;
+}
+
+// Build cost of the maps behind the lookup tables: rows = kind, cols = N.
+Table make_build_cost_table(std::span<const BenchSet> results) {
+    Table table;
+    table.headers.emplace_back("kind");
+    for (const auto& set : results) {
+        table.headers.emplace_back(std::format("N = 1 << {}", set.shift));
+    }
+    for (const auto& row_spec : ROWS) {
+        std::vector<std::string> row;
+        row.emplace_back(row_spec.name);
+        for (const auto& set : results) {
+            row.emplace_back(std::format("{:.1f}", (set.*(row_spec.member)).front().build_ns));
         }
-        table.widths[idx] += 2; // left + right padding
+        table.rows.emplace_back(std::move(row));
+    }
+    fit_widths(table);
+    return table;
+}
+
+template <uint64_t BUCKET>
+std::vector<std::string> load_factor_row(std::span<const uint64_t> keys) {
+    std::vector<std::string> row;
+    row.emplace_back(std::format("{}", BUCKET));
+    for (const auto kicks : MAX_KICKS) {
+        const auto load =
+            max_load_factor<TwoWay<detail::U64ToU64TableTrait, BUCKET>>(keys, kicks);
+        row.emplace_back(std::format("{:.3f}", load));
+    }
+    return row;
+}
+
+Table make_insert_latency_table() {
+    Table table;
+    table.headers.emplace_back("migrate step");
+    for (const auto shift : LATENCY_KEYS_SHIFT) {
+        table.headers.emplace_back(std::format("N = 1 << {}", shift));
+    }
+    std::vector<std::vector<uint64_t>> key_sets{};
+    for (const auto shift : LATENCY_KEYS_SHIFT) {
+        key_sets.emplace_back(make_keys(1ULL << shift));
+    }
+    for (const auto step : MIGRATE_STEPS) {
+        std::vector<std::string> row;
+        row.emplace_back(step == 0 ? std::string("full rehash") : std::format("{}", step));
+        for (const auto& keys : key_sets) {
+            const auto latency = benchmark_insert_latency<TwoWay<detail::U64ToU64TableTrait, 4>>(
+                keys, step);
+            row.emplace_back(std::format("{}/{}", latency.max_ns, latency.p999_ns));
+        }
+        table.rows.emplace_back(std::move(row));
+    }
+    fit_widths(table);
+    return table;
+}
+
+template <typename TableTrait, uint64_t BUCKET>
+std::vector<std::string> bucket_sweep_row(
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups) {
+    using Key = typename TableTrait::Key;
+    const auto sweep =
+        benchmark_bucket_width<TwoWay<TableTrait, BUCKET>>(keys, lookups, ITERS);
+    std::vector<std::string> row;
+    row.emplace_back(std::format("u{}", sizeof(Key) * 8));
+    row.emplace_back(
+        BUCKET == LINE_BUCKET<Key> ? std::format("{} (line)", BUCKET) : std::format("{}", BUCKET));
+    row.emplace_back(format_cell(sweep.lookup));
+    row.emplace_back(std::format("{:.3f}", sweep.max_load));
+    row.emplace_back(std::format("{:.1f}", sweep.bytes_per_entry));
+    return row;
+}
+
+template <typename TableTrait>
+void bucket_sweep_rows(
+    Table& table,
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups) {
+    table.rows.emplace_back(bucket_sweep_row<TableTrait, 2>(keys, lookups));
+    table.rows.emplace_back(bucket_sweep_row<TableTrait, 4>(keys, lookups));
+    table.rows.emplace_back(bucket_sweep_row<TableTrait, 8>(keys, lookups));
+    table.rows.emplace_back(bucket_sweep_row<TableTrait, 16>(keys, lookups));
+}
+
+Table make_bucket_sweep_table(std::span<const uint64_t> keys, std::mt19937_64& rng) {
+    Table table;
+    table.headers = {"key", "bucket", "lookup", "max load", "bytes/entry"};
+    std::uniform_int_distribution<size_t> dist{0, keys.size() - 1};
+    std::vector<uint64_t> lookups{};
+    lookups.reserve(ITERS * SWEEP_BATCH);
+    for (size_t i = 0; i < ITERS * SWEEP_BATCH; i++) {
+        lookups.emplace_back(keys[dist(rng)]);
+    }
+    bucket_sweep_rows<detail::U32ToU32TableTrait>(table, keys, lookups);
+    bucket_sweep_rows<detail::U64ToU64TableTrait>(table, keys, lookups);
+    fit_widths(table);
+    return table;
+}
+
+template <typename Map>
+std::vector<std::string> key_compression_row(
+    std::string_view name,
+    std::span<const uint64_t> keys,
+    std::span<const uint64_t> lookups) {
+    const auto result = benchmark_key_compression<Map>(keys, lookups, ITERS);
+    return {
+        std::string{name},
+        std::format("1 << {}", std::countr_zero(keys.size())),
+        format_cell(result.lookup),
+        std::format("{:.3f}", result.load_factor),
+        std::format("{:.1f}", result.bytes_per_entry),
+    };
+}
+
+// Rows are (map, N) pairs; lookups are random hits in batches of SWEEP_BATCH.
+Table make_key_compression_table(std::mt19937_64& rng) {
+    Table table;
+    table.headers = {"keys", "N", "lookup", "load", "bytes/entry"};
+    for (const auto shift : QUOTIENT_KEYS_SHIFT) {
+        const auto keys = make_keys(1ULL << shift);
+        std::uniform_int_distribution<size_t> dist{0, keys.size() - 1};
+        std::vector<uint64_t> lookups(ITERS * SWEEP_BATCH);
+        for (auto& lookup : lookups) {
+            lookup = keys[dist(rng)];
+        }
+        table.rows.emplace_back(key_compression_row<TwoWay<detail::U64ToU64TableTrait>>(
+            "twoway, u64 keys", keys, lookups));
+        table.rows.emplace_back(key_compression_row<QuotientTwoWay<uint64_t, 40, uint32_t>>(
+            "quotient, u32 lanes (< 2^40)", keys, lookups));
+        table.rows.emplace_back(key_compression_row<QuotientTwoWay<uint64_t, 24, uint16_t>>(
+            "quotient, u16 lanes (< 2^24)", keys, lookups));
+    }
+    fit_widths(table);
+    return table;
+}
+
+struct ProbeRow {
+    std::string key;
+    std::string bucket;
+    ProbeSweep sweep;
+};
+
+template <typename TableTrait, uint64_t BUCKET, bool TAGS = false>
+ProbeRow probe_row(std::span<const uint64_t> keys, std::span<const uint64_t> lookups) {
+    using Key = typename TableTrait::Key;
+    using Map = TwoWay<TableTrait, BUCKET, TAGS, layout::Split, stats::Probes>;
+    return {
+        std::format("u{}", sizeof(Key) * 8),
+        std::format(
+            "{}{}{}", BUCKET, BUCKET == LINE_BUCKET<Key> ? " (line)" : "", TAGS ? " tags" : ""),
+        benchmark_probe_stats<Map>(keys, lookups),
+    };
+}
+
+// Same keys as the bucket width sweep, random lookups of which PROBE_MISS_PERCENT% are absent.
+std::vector<ProbeRow> run_probe_sweep(std::span<const uint64_t> keys, std::mt19937_64& rng) {
+    std::uniform_int_distribution<size_t> dist{0, keys.size() - 1};
+    std::uniform_int_distribution<uint64_t> percent{0, 99};
+    std::vector<uint64_t> lookups{};
+    lookups.reserve(ITERS * SWEEP_BATCH);
+    for (size_t i = 0; i < ITERS * SWEEP_BATCH; i++) {
+        const auto key = keys[dist(rng)];
+        lookups.emplace_back(percent(rng) < PROBE_MISS_PERCENT ? key + keys.size() : key);
+    }
+    using U32 = detail::U32ToU32TableTrait;
+    using U64 = detail::U64ToU64TableTrait;
+    std::vector<ProbeRow> rows{};
+    rows.emplace_back(probe_row<U32, 8>(keys, lookups));
+    rows.emplace_back(probe_row<U32, 16>(keys, lookups));
+    rows.emplace_back(probe_row<U64, 2>(keys, lookups));
+    rows.emplace_back(probe_row<U64, 4>(keys, lookups));
+    rows.emplace_back(probe_row<U64, 4, true>(keys, lookups));
+    rows.emplace_back(probe_row<U64, 8>(keys, lookups));
+    return rows;
+}
+
+std::string percent_of(uint64_t count, uint64_t total) {
+    return std::format(
+        "{:.1f}%",
+        100.0 * static_cast<double>(count) / static_cast<double>(std::max<uint64_t>(total, 1)));
+}
+
+Table make_probe_stats_table(std::span<const ProbeRow> rows) {
+    Table table;
+    table.headers = {
+        "key", "bucket", "first", "second", "stash", "miss", "lane 0", "mean len", "p50/p99 len"};
+    for (const auto& [key, bucket, sweep] : rows) {
+        const auto& probes = sweep.probes;
+        const auto lookups = probes.hits() + probes.misses;
+        table.rows.push_back({
+            key,
+            bucket,
+            percent_of(probes.choices[stats::FIRST], lookups),
+            percent_of(probes.choices[stats::SECOND], lookups),
+            percent_of(probes.choices[stats::STASH], lookups),
+            percent_of(probes.misses, lookups),
+            percent_of(probes.lanes[0], lookups),
+            std::format("{:.2f}", probes.mean_length()),
+            std::format("{}/{}", probes.length_quantile(0.5), probes.length_quantile(0.99)),
+        });
+    }
+    fit_widths(table);
+    return table;
+}
+
+constexpr std::array<std::string_view, 7> OCCUPANCY_HEADERS{
+    "load", "fill %", "2nd", "stash", "hit len", "miss len", "bytes/entry"};
+
+// TwoWay::stats() as table cells; fill % lists the share of buckets holding 0, 1, ... BUCKET
+// entries.
+std::vector<std::string> occupancy_cells(const stats::Occupancy& occupancy) {
+    std::string fill;
+    for (const auto buckets : occupancy.fill) {
+        fill += std::format(
+            "{}{:.0f}",
+            fill.empty() ? "" : "/",
+            100.0 * static_cast<double>(buckets) / static_cast<double>(occupancy.buckets));
+    }
+    return {
+        std::format("{:.3f}", occupancy.load_factor),
+        std::move(fill),
+        std::format("{:.1f}%", 100.0 * occupancy.second_fraction),
+        std::format("{}", occupancy.stashed),
+        std::format("{:.2f}", occupancy.hit_cost),
+        std::format("{:.2f}", occupancy.miss_cost),
+        std::format("{:.1f}", occupancy.bytes_per_entry),
+    };
+}
+
+Table make_occupancy_table(std::span<const ProbeRow> rows) {
+    Table table;
+    table.headers = {"key", "bucket"};
+    table.headers.insert(table.headers.end(), OCCUPANCY_HEADERS.begin(), OCCUPANCY_HEADERS.end());
+    for (const auto& [key, bucket, sweep] : rows) {
+        std::vector<std::string> row{key, bucket};
+        auto cells = occupancy_cells(sweep.occupancy);
+        row.insert(row.end(), cells.begin(), cells.end());
+        table.rows.emplace_back(std::move(row));
+    }
+    fit_widths(table);
+    return table;
+}
+
+// stats() of the map behind the "twoway" lookup rows. The tags, batch and other layout rows
+// place their entries exactly the same way.
+Table make_lookup_occupancy_table(std::span<const BenchSet> results) {
+    Table table;
+    table.headers = {"N"};
+    table.headers.insert(table.headers.end(), OCCUPANCY_HEADERS.begin(), OCCUPANCY_HEADERS.end());
+    for (const auto& set : results) {
+        std::vector<std::string> row{std::format("1 << {}", set.shift)};
+        auto cells = occupancy_cells(set.twoway.front().occupancy);
+        row.insert(row.end(), cells.begin(), cells.end());
+        table.rows.emplace_back(std::move(row));
+    }
+    fit_widths(table);
+    return table;
+}
+
+Table make_concurrent_table(std::span<const uint64_t> keys, std::mt19937_64& rng) {
+    Table table;
+    table.headers.emplace_back("kind");
+    for (const auto threads : READER_THREADS) {
+        table.headers.emplace_back(std::format("{} threads", threads));
+    }
+    std::uniform_int_distribution<size_t> dist{0, keys.size() - 1};
+    std::vector<uint64_t> lookups{};
+    lookups.reserve(ITERS * SWEEP_BATCH);
+    for (size_t i = 0; i < ITERS * SWEEP_BATCH; i++) {
+        lookups.emplace_back(keys[dist(rng)]);
+    }
+
+    using Concurrent = ConcurrentTwoWay<detail::U64ToU64TableTrait>;
+    using Shared = TwoWay<detail::U64ToU64TableTrait>;
+    std::vector<std::string> concurrent{"twoway-concurrent"};
+    std::vector<std::string> shared{"twoway (read-only)"};
+    std::vector<std::string> boost{"boost + shared_mutex"};
+    for (const auto threads : READER_THREADS) {
+        concurrent.emplace_back(std::format(
+            "{:.1f}", benchmark_concurrent_twoway<Concurrent>(keys, lookups, threads)));
+        shared.emplace_back(
+            std::format("{:.1f}", benchmark_shared_twoway<Shared>(keys, lookups, threads)));
+        boost.emplace_back(
+            std::format("{:.1f}", benchmark_boost_shared_mutex(keys, lookups, threads)));
+    }
+    table.rows.emplace_back(std::move(concurrent));
+    table.rows.emplace_back(std::move(shared));
+    table.rows.emplace_back(std::move(boost));
+    fit_widths(table);
+    return table;
+}
+
+// 1, 2, 4, ... up to and including std::thread::hardware_concurrency().
+std::vector<size_t> writer_thread_counts() {
+    const size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<size_t> counts{};
+    for (size_t threads = 1; threads < max_threads; threads *= 2) {
+        counts.emplace_back(threads);
+    }
+    counts.emplace_back(max_threads);
+    return counts;
+}
+
+Table make_ingest_table(std::span<const uint64_t> keys) {
+    using Sharded = ShardedTwoWay<detail::U64ToU64TableTrait>;
+    using Single = TwoWay<detail::U64ToU64TableTrait>;
+    const auto thread_counts = writer_thread_counts();
+
+    Table table;
+    table.headers.emplace_back("kind");
+    for (const auto threads : thread_counts) {
+        table.headers.emplace_back(std::format("{} threads", threads));
+    }
+    std::vector<std::string> sharded{"twoway-sharded"};
+    std::vector<std::string> sharded_batch{"twoway-sharded (insert_many)"};
+    std::vector<std::string> locked{"twoway + mutex"};
+    for (const auto threads : thread_counts) {
+        sharded.emplace_back(
+            std::format("{:.1f}", benchmark_sharded_insert<Sharded>(keys, threads)));
+        sharded_batch.emplace_back(
+            std::format("{:.1f}", benchmark_sharded_insert_many<Sharded>(keys, threads)));
+        locked.emplace_back(
+            std::format("{:.1f}", benchmark_locked_twoway_insert<Single>(keys, threads)));
+    }
+    table.rows.emplace_back(std::move(sharded));
+    table.rows.emplace_back(std::move(sharded_batch));
+    table.rows.emplace_back(std::move(locked));
+    fit_widths(table);
+    return table;
+}
+
+Table make_build_table(std::span<const uint64_t> keys) {
+    using Map = TwoWay<detail::U64ToU64TableTrait>;
+    const auto thread_counts = writer_thread_counts();
+
+    Table table;
+    table.headers.emplace_back("kind");
+    for (const auto threads : thread_counts) {
+        table.headers.emplace_back(std::format("{} threads", threads));
+    }
+    std::vector<std::string> build{"build (pre-sized, CAS)"};
+    std::vector<std::string> serial{"insert() (serial)"};
+    for (const auto threads : thread_counts) {
+        build.emplace_back(std::format("{:.1f}", benchmark_build<Map>(keys, threads)));
+        serial.emplace_back(
+            threads == 1 ? std::format("{:.1f}", benchmark_serial_insert<Map>(keys)) : "-");
+    }
+    table.rows.emplace_back(std::move(build));
+    table.rows.emplace_back(std::move(serial));
+    fit_widths(table);
+    return table;
+}
+
+// Zero-padded decimal keys, so long keys share a long common prefix.
+std::vector<std::string> make_strings(std::span<const uint64_t> keys, size_t bytes) {
+    std::vector<std::string> strings{};
+    strings.reserve(keys.size());
+    for (const auto key : keys) {
+        strings.emplace_back(std::format("{:0{}}", key, bytes));
+    }
+    return strings;
+}
+
+Table make_string_table(
+    std::span<const uint64_t> keys,
+    std::span<const std::vector<uint64_t>> lookup_sets,
+    size_t bytes) {
+    Table table;
+    table.headers.emplace_back("kind");
+    for (const auto batch_size : BATCH_SIZE) {
+        table.headers.emplace_back(std::format("{}", batch_size));
+    }
+
+    const auto strings = make_strings(keys, bytes);
+    const std::array<std::pair<std::string_view, std::vector<BenchResult>>, 4> rows{{
+        {"twoway",
+         benchmark_string_twoway<StringTwoWay<detail::StringToU64TableTrait>>(
+             strings, lookup_sets, ITERS)},
+        {"boost",
+         benchmark_string_map<boost::unordered::unordered_flat_map<std::string, uint64_t>>(
+             strings, lookup_sets, ITERS)},
+        {"absl",
+         benchmark_string_map<absl::flat_hash_map<std::string, uint64_t>>(
+             strings, lookup_sets, ITERS)},
+        {"std",
+         benchmark_string_map<std::unordered_map<std::string, uint64_t>>(
+             strings, lookup_sets, ITERS)},
+    }};
+    for (const auto& [name, results] : rows) {
+        sink_results(results);
+        std::vector<std::string> row;
+        row.emplace_back(name);
+        for (const auto& result : results) {
+            row.emplace_back(format_cell(result));
+        }
+        table.rows.emplace_back(std::move(row));
     }
 
+    fit_widths(table);
+    return table;
+}
+
+// Rows are grow() factors plus a reserve(N)'d table, columns the same N as insert latency.
+Table make_growth_table() {
+    Table table;
+    table.headers.emplace_back("growth");
+    for (const auto shift : LATENCY_KEYS_SHIFT) {
+        table.headers.emplace_back(std::format("N = 1 << {}", shift));
+    }
+    std::vector<std::vector<uint64_t>> key_sets{};
+    for (const auto shift : LATENCY_KEYS_SHIFT) {
+        key_sets.emplace_back(make_keys(1ULL << shift));
+    }
+    using Map = TwoWay<detail::U64ToU64TableTrait>;
+    auto add_row = [&](std::string name, double growth, bool reserve) {
+        std::vector<std::string> row{std::move(name)};
+        for (const auto& keys : key_sets) {
+            const auto cost = benchmark_growth<Map>(keys, growth, reserve);
+            row.emplace_back(std::format("{:.1f}/{:.1f}", cost.insert_ns, cost.bytes_per_entry));
+        }
+        table.rows.emplace_back(std::move(row));
+    };
+    for (const auto growth : GROWTH) {
+        add_row(std::format("x{:.2f}", growth), growth, false);
+    }
+    add_row("reserve(N)", GROWTH.front(), true);
+    fit_widths(table);
+    return table;
+}
+
+Table make_startup_table() {
+    Table table;
+    table.headers.emplace_back("startup");
+    for (const auto shift : STARTUP_KEYS_SHIFT) {
+        table.headers.emplace_back(std::format("N = 1 << {}", shift));
+    }
+    const auto path = std::filesystem::temp_directory_path() / "twoway_startup.snapshot";
+    std::vector<std::string> rebuild{"rebuild"};
+    std::vector<std::string> mapped{"open_mapped"};
+    std::vector<std::string> verified{"open_mapped + verify"};
+    for (const auto shift : STARTUP_KEYS_SHIFT) {
+        const auto cost = benchmark_startup<TwoWay<detail::U64ToU64TableTrait>>(
+            make_keys(1ULL << shift), path.c_str());
+        rebuild.emplace_back(std::format("{:.3f}", cost.rebuild_ms));
+        mapped.emplace_back(std::format("{:.3f}", cost.mapped_ms));
+        verified.emplace_back(std::format("{:.3f}", cost.verified_ms));
+    }
+    table.rows.emplace_back(std::move(rebuild));
+    table.rows.emplace_back(std::move(mapped));
+    table.rows.emplace_back(std::move(verified));
+    fit_widths(table);
+    return table;
+}
+
+// Rows are read-modify-write idioms, columns the number of distinct keys counted.
+Table make_counter_table(std::mt19937_64& rng) {
+    Table table;
+    table.headers.emplace_back("increment");
+    for (const auto shift : COUNTER_KEYS_SHIFT) {
+        table.headers.emplace_back(std::format("N = 1 << {}", shift));
+    }
+    std::vector<std::vector<uint64_t>> streams{};
+    for (const auto shift : COUNTER_KEYS_SHIFT) {
+        std::uniform_int_distribution<uint64_t> dist{1, 1ULL << shift};
+        std::vector<uint64_t> stream(COUNTER_OPS);
+        for (auto& key : stream) {
+            key = dist(rng);
+        }
+        streams.emplace_back(std::move(stream));
+    }
+    auto add_row = [&]<typename Map>(std::string name, auto&& bump) {
+        std::vector<std::string> row{std::move(name)};
+        for (const auto& stream : streams) {
+            row.emplace_back(std::format("{:.1f}", benchmark_counter<Map>(stream, bump)));
+        }
+        table.rows.emplace_back(std::move(row));
+    };
+    using Twoway = TwoWay<detail::U64ToU64TableTrait>;
+    add_row.operator()<Twoway>("twoway contains + find_ptr/insert", [](Twoway& map, uint64_t key) {
+        if (map.contains(key)) {
+            ++*map.find_ptr(key);
+        } else {
+            map.insert(key, 1);
+        }
+    });
+    add_row.operator()<Twoway>("twoway find_or_insert", [](Twoway& map, uint64_t key) {
+        ++map.find_or_insert(key);
+    });
+    add_row.operator()<Twoway>("twoway update", [](Twoway& map, uint64_t key) {
+        map.update(key, [](uint64_t& count) { ++count; });
+    });
+    auto subscript = [](auto& map, uint64_t key) { ++map[key]; };
+    add_row.operator()<boost::unordered::unordered_flat_map<uint64_t, uint64_t>>(
+        "boost operator[]", subscript);
+    add_row.operator()<absl::flat_hash_map<uint64_t, uint64_t>>("absl operator[]", subscript);
+    add_row.operator()<std::unordered_map<uint64_t, uint64_t>>("std operator[]", subscript);
+    fit_widths(table);
+    return table;
+}
+
+// Rows are sets (and a map used as one), columns ns per contains() and bytes per key for each N.
+Table make_membership_table(std::mt19937_64& rng) {
+    Table table;
+    table.headers.emplace_back("set");
+    for (const auto shift : MEMBERSHIP_KEYS_SHIFT) {
+        table.headers.emplace_back(std::format("ns, 1 << {}", shift));
+        table.headers.emplace_back(std::format("B/key, 1 << {}", shift));
+    }
+    std::vector<std::pair<std::vector<uint64_t>, std::vector<uint64_t>>> workloads{};
+    for (const auto shift : MEMBERSHIP_KEYS_SHIFT) {
+        auto keys = make_keys(1ULL << shift);
+        std::uniform_int_distribution<size_t> dist{0, keys.size() - 1};
+        std::uniform_int_distribution<uint64_t> percent{0, 99};
+        std::vector<uint64_t> lookups(MEMBERSHIP_LOOKUPS);
+        for (auto& lookup : lookups) {
+            const auto key = keys[dist(rng)];
+            lookup = percent(rng) < MEMBERSHIP_MISS_PERCENT ? key + keys.size() : key;
+        }
+        workloads.emplace_back(std::move(keys), std::move(lookups));
+    }
+    auto add_row = [&]<typename Set>(std::string name, auto&& insert, auto&& footprint) {
+        std::vector<std::string> row{std::move(name)};
+        for (const auto& [keys, lookups] : workloads) {
+            const auto result = benchmark_membership<Set>(keys, lookups, insert, footprint);
+            row.emplace_back(std::format("{:.1f}", result.lookup_ns));
+            row.emplace_back(std::format("{:.1f}", result.bytes_per_entry));
+        }
+        table.rows.emplace_back(std::move(row));
+    };
+    using Trait = detail::U64ToU64TableTrait;
+    auto memory_usage = [](auto& set, uint64_t) { return set.memory_usage(); };
+    auto allocated = [](auto& set, uint64_t bytes) { return bytes + sizeof(set); };
+    add_row.operator()<TwoWay<Trait>>(
+        "twoway map", [](auto& map, uint64_t key) { map.insert(key, key); }, memory_usage);
+    auto insert_key = [](auto& set, uint64_t key) { set.insert(key); };
+    add_row.operator()<TwoWaySet<Trait>>("twoway set", insert_key, memory_usage);
+    add_row.operator()<TwoWaySet<Trait, 4, true>>("twoway set (4, tags)", insert_key, memory_usage);
+    add_row.operator()<boost::unordered::unordered_flat_set<
+        uint64_t,
+        boost::hash<uint64_t>,
+        std::equal_to<uint64_t>,
+        detail::CountingAllocator<uint64_t>>>("boost flat_set", insert_key, allocated);
+    add_row.operator()<fph::DynamicFphSet<
+        uint64_t,
+        fph::SimpleSeedHash<uint64_t>,
+        std::equal_to<uint64_t>,
+        detail::CountingAllocator<uint64_t>>>("fph set", insert_key, allocated);
+    fit_widths(table);
+    return table;
+}
+
+template <size_t N>
+consteval std::array<std::pair<uint64_t, uint64_t>, N> make_static_entries() {
+    std::array<std::pair<uint64_t, uint64_t>, N> entries{};
+    for (uint64_t i = 0; i < N; i++) {
+        entries[i] = {i + 1, i + 1};
+    }
+    return entries;
+}
+
+template <size_t N>
+constexpr auto STATIC_ENTRIES = make_static_entries<N>();
+template <size_t N>
+constexpr auto STATIC_TABLE = make_static_two_way<detail::U64ToU64TableTrait>(STATIC_ENTRIES<N>);
+
+template <size_t SHIFT>
+void static_table_columns(Table& table, std::mt19937_64& rng) {
+    constexpr size_t N = size_t{1} << SHIFT;
+    std::uniform_int_distribution<uint64_t> dist{1, N};
+    std::vector<uint64_t> lookups(STATIC_LOOKUPS);
+    for (auto& key : lookups) {
+        key = dist(rng);
+    }
+    using Map = TwoWay<detail::U64ToU64TableTrait>;
+    table.headers.emplace_back(std::format("build us, 1 << {}", SHIFT));
+    table.headers.emplace_back(std::format("ns, 1 << {}", SHIFT));
+    table.rows[0].emplace_back("-");
+    table.rows[0].emplace_back(
+        std::format("{:.2f}", benchmark_find_ns(STATIC_TABLE<N>, lookups)));
+    for (const bool bulk : {false, true}) {
+        const auto built = benchmark_runtime_built<Map>(STATIC_ENTRIES<N>, lookups, bulk);
+        auto& row = table.rows[bulk ? 2 : 1];
+        row.emplace_back(std::format("{:.1f}", built.build_us));
+        row.emplace_back(std::format("{:.2f}", built.lookup_ns));
+    }
+}
+
+// Rows are a compile-time image and two ways of building the same table at startup.
+Table make_static_table(std::mt19937_64& rng) {
+    Table table;
+    table.headers.emplace_back("table");
+    table.rows = {{"static (constexpr image)"}, {"twoway, insert()"}, {"twoway, bulk ctor"}};
+    static_table_columns<STATIC_KEYS_SHIFT[0]>(table, rng);
+    static_table_columns<STATIC_KEYS_SHIFT[1]>(table, rng);
+    static_table_columns<STATIC_KEYS_SHIFT[2]>(table, rng);
+    fit_widths(table);
+    return table;
+}
+
+// Rows are ways to visit every entry, columns the number of entries.
+Table make_scan_table() {
+    Table table;
+    table.headers.emplace_back("scan");
+    for (const auto shift : SCAN_KEYS_SHIFT) {
+        table.headers.emplace_back(std::format("N = 1 << {}", shift));
+    }
+    std::vector<std::vector<uint64_t>> key_sets{};
+    for (const auto shift : SCAN_KEYS_SHIFT) {
+        key_sets.emplace_back(make_keys(1ULL << shift));
+    }
+    using Trait = detail::U64ToU64TableTrait;
+    auto add_row = [&](std::string name, auto&& scan) {
+        std::vector<std::string> row{std::move(name)};
+        for (const auto& keys : key_sets) {
+            row.emplace_back(std::format("{:.2f}", scan(std::span<const uint64_t>{keys})));
+        }
+        table.rows.emplace_back(std::move(row));
+    };
+    add_row("twoway sum_all_values", benchmark_twoway_scan<TwoWay<Trait>>);
+    add_row("twoway for_each", benchmark_twoway_for_each<TwoWay<Trait>>);
+    add_row(
+        "twoway-separate sum_all_values",
+        benchmark_twoway_scan<TwoWay<Trait, 4, false, layout::Separate>>);
+    add_row(
+        "twoway-interleaved sum_all_values",
+        benchmark_twoway_scan<TwoWay<Trait, 4, false, layout::Interleaved>>);
+    add_row("boost", benchmark_map_scan<boost::unordered::unordered_flat_map<uint64_t, uint64_t>>);
+    add_row("absl", benchmark_map_scan<absl::flat_hash_map<uint64_t, uint64_t>>);
+    add_row("std", benchmark_map_scan<std::unordered_map<uint64_t, uint64_t>>);
+    add_row("flat", benchmark_flat_map_scan);
+    fit_widths(table);
+    return table;
+}
+
+Table make_load_factor_table(std::span<const uint64_t> keys) {
+    Table table;
+    table.headers.emplace_back("bucket");
+    for (const auto kicks : MAX_KICKS) {
+        table.headers.emplace_back(std::format("kicks={}", kicks));
+    }
+    table.rows.emplace_back(load_factor_row<1>(keys));
+    table.rows.emplace_back(load_factor_row<2>(keys));
+    table.rows.emplace_back(load_factor_row<4>(keys));
+    table.rows.emplace_back(load_factor_row<8>(keys));
+    fit_widths(table);
     return table;
 }
 
@@ -283,6 +1010,16 @@ void print_table(const Table& table) {
     print_rule(std::span<const size_t>{table.widths});
 }
 
+void print_table_section(std::string_view title, const Table& table) {
+    const auto width = grid_width(std::span<const size_t>{table.widths});
+    std::println("{}", std::string(width, '-'));
+    std::println();
+    std::println("{:^{}}", title, width);
+    std::println();
+    print_table(table);
+    std::println();
+}
+
 void print_section(std::string_view title, std::span<const BenchSet> results) {
     std::vector<TableOutput> tables;
     tables.reserve(results.size());
@@ -310,6 +1047,7 @@ void print_section(std::string_view title, std::span<const BenchSet> results) {
 int main() {
     std::vector<BenchSet> random_results{};
     std::vector<BenchSet> dense_results{};
+    std::array<std::vector<BenchSet>, MISS_PERCENT.size()> miss_results{};
     random_results.reserve(NUM_KEYS_SHIFT.size());
     dense_results.reserve(NUM_KEYS_SHIFT.size());
 
@@ -329,10 +1067,80 @@ int main() {
 
         random_results.emplace_back(std::move(random_set));
         dense_results.emplace_back(std::move(dense_set));
+
+        for (size_t idx = 0; idx < MISS_PERCENT.size(); idx++) {
+            auto miss_lookup_sets = make_miss_lookup_sets(keys, MISS_PERCENT[idx], rng);
+            auto miss_set = run_benchmarks(shift, keys, miss_lookup_sets);
+            sink_all(miss_set);
+            miss_results[idx].emplace_back(std::move(miss_set));
+        }
     }
 
     print_section("Spare elements", std::span<const BenchSet>{random_results});
     print_section("Dense set of elements", std::span<const BenchSet>{dense_results});
+    print_table_section(
+        "Build time, ns per key", make_build_cost_table(std::span<const BenchSet>{random_results}));
+    print_table_section(
+        "Occupancy behind the twoway rows (stats())",
+        make_lookup_occupancy_table(std::span<const BenchSet>{random_results}));
+    for (size_t idx = 0; idx < MISS_PERCENT.size(); idx++) {
+        print_section(
+            std::format("Spare elements, {}% misses", MISS_PERCENT[idx]),
+            std::span<const BenchSet>{miss_results[idx]});
+    }
+
+    const auto load_keys = make_keys(1ULL << NUM_KEYS_SHIFT.back());
+    print_table_section("Max load factor before grow (twoway)", make_load_factor_table(load_keys));
+    print_table_section("Insert latency during growth (twoway)", make_insert_latency_table());
+    print_table_section(
+        "Growth factor (twoway), ns per insert / bytes per entry", make_growth_table());
+    print_table_section("Time to first lookup (twoway), ms", make_startup_table());
+    print_table_section("Full-table scan (sum of values), ns per entry", make_scan_table());
+    std::mt19937_64 static_rng{0x57A7};
+    print_table_section(
+        "Static key sets, startup build time / ns per lookup", make_static_table(static_rng));
+    std::mt19937_64 counter_rng{0xC0C0};
+    print_table_section(
+        std::format("Counter increments, ns per increment ({} increments)", COUNTER_OPS),
+        make_counter_table(counter_rng));
+    std::mt19937_64 membership_rng{0x5E7};
+    print_table_section(
+        std::format(
+            "Membership, ns per contains() / bytes per key ({}% misses)", MEMBERSHIP_MISS_PERCENT),
+        make_membership_table(membership_rng));
+    std::mt19937_64 sweep_rng{0xB0C4E7};
+    print_table_section(
+        std::format("Bucket width sweep (twoway, {} random lookups per batch)", SWEEP_BATCH),
+        make_bucket_sweep_table(make_keys(SWEEP_KEYS), sweep_rng));
+    print_table_section(
+        std::format("Quotiented keys, {} random lookups per batch", SWEEP_BATCH),
+        make_key_compression_table(sweep_rng));
+    const auto probe_rows = run_probe_sweep(make_keys(SWEEP_KEYS), sweep_rng);
+    print_table_section(
+        std::format(
+            "Probe statistics (instrumented twoway, {}% misses), share of lookups",
+            PROBE_MISS_PERCENT),
+        make_probe_stats_table(probe_rows));
+    print_table_section(
+        "Occupancy of the same maps (twoway stats())", make_occupancy_table(probe_rows));
+    print_table_section(
+        "Concurrent lookups, ns per lookup (wall time)",
+        make_concurrent_table(load_keys, sweep_rng));
+    print_table_section(
+        "Multi-writer ingest, million inserts per second",
+        make_ingest_table(make_keys(1ULL << INGEST_KEYS_SHIFT)));
+    print_table_section(
+        std::format("Bulk load of 1 << {} keys, million entries per second", BUILD_KEYS_SHIFT),
+        make_build_table(make_keys(1ULL << BUILD_KEYS_SHIFT)));
+
+    const auto string_keys = make_keys(1ULL << STRING_KEYS_SHIFT);
+    std::mt19937_64 string_rng{0x5781};
+    const auto string_lookup_sets = make_random_lookup_sets(string_keys, string_rng);
+    for (const auto bytes : STRING_KEY_BYTES) {
+        print_table_section(
+            std::format("{}-byte string keys, N = 1 << {}", bytes, STRING_KEYS_SHIFT),
+            make_string_table(string_keys, string_lookup_sets, bytes));
+    }
 
     return 0;
 }
@@ -0,0 +1,289 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Bucket probe kernels. `match` compares a needle against every lane of a bucket and returns
+// one bit per equal lane, so callers resolve hits with a countr_zero instead of a lane loop.
+namespace simd {
+
+// Lane types the vector kernels handle; everything else takes the scalar loop.
+template <typename T, uint64_t LANES>
+inline constexpr bool has_vector_probe =
+    std::is_integral_v<T> && (sizeof(T) != 16) &&
+    (sizeof(T) * LANES) % 16 == 0;
+
+#if defined(__x86_64__) || defined(_M_X64)
+#if defined(__AVX512F__)
+inline constexpr uint64_t VECTOR_BYTES = 64;
+#elif defined(__AVX2__)
+inline constexpr uint64_t VECTOR_BYTES = 32;
+#else
+inline constexpr uint64_t VECTOR_BYTES = 16;
+#endif
+
+template <typename U>
+inline uint64_t match_16(const U* lanes, U needle) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+    if constexpr (sizeof(U) == 1) {
+        const __m128i eq = _mm_cmpeq_epi8(v, _mm_set1_epi8(static_cast<char>(needle)));
+        return static_cast<uint64_t>(_mm_movemask_epi8(eq));
+    } else if constexpr (sizeof(U) == 2) {
+        // The saturating pack narrows every 16-bit flag to one byte.
+        const __m128i eq = _mm_cmpeq_epi16(v, _mm_set1_epi16(static_cast<short>(needle)));
+        return static_cast<uint64_t>(_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128())));
+    } else if constexpr (sizeof(U) == 4) {
+        const __m128i eq = _mm_cmpeq_epi32(v, _mm_set1_epi32(static_cast<int>(needle)));
+        return static_cast<uint64_t>(_mm_movemask_ps(_mm_castsi128_ps(eq)));
+    } else {
+        const __m128i n = _mm_set1_epi64x(static_cast<long long>(needle));
+#if defined(__SSE4_1__)
+        const __m128i eq = _mm_cmpeq_epi64(v, n);
+#else
+        // SSE2 has no 64-bit compare: both 32-bit halves have to match.
+        __m128i eq = _mm_cmpeq_epi32(v, n);
+        eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+        return static_cast<uint64_t>(_mm_movemask_pd(_mm_castsi128_pd(eq)));
+    }
+}
+
+#if defined(__AVX2__)
+template <typename U>
+inline uint64_t match_32(const U* lanes, U needle) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+    if constexpr (sizeof(U) == 1) {
+        const __m256i eq = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(static_cast<char>(needle)));
+        return static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+    } else if constexpr (sizeof(U) == 2) {
+        const __m256i eq = _mm256_cmpeq_epi16(v, _mm256_set1_epi16(static_cast<short>(needle)));
+        const __m128i flags =
+            _mm_packs_epi16(_mm256_castsi256_si128(eq), _mm256_extracti128_si256(eq, 1));
+        return static_cast<uint64_t>(_mm_movemask_epi8(flags));
+    } else if constexpr (sizeof(U) == 4) {
+        const __m256i eq = _mm256_cmpeq_epi32(v, _mm256_set1_epi32(static_cast<int>(needle)));
+        return static_cast<uint64_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    } else {
+        const __m256i eq =
+            _mm256_cmpeq_epi64(v, _mm256_set1_epi64x(static_cast<long long>(needle)));
+        return static_cast<uint64_t>(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+    }
+}
+#endif
+
+#if defined(__AVX512F__)
+template <typename U>
+inline uint64_t match_64(const U* lanes, U needle) {
+    if constexpr (sizeof(U) == 2) {
+#if defined(__AVX512BW__)
+        const __m512i v = _mm512_loadu_si512(lanes);
+        return _mm512_cmpeq_epi16_mask(v, _mm512_set1_epi16(static_cast<short>(needle)));
+#else
+        return match_32(lanes, needle) | match_32(lanes + 16, needle) << 16;
+#endif
+    } else if constexpr (sizeof(U) == 4) {
+        const __m512i v = _mm512_loadu_si512(lanes);
+        return _mm512_cmpeq_epi32_mask(v, _mm512_set1_epi32(static_cast<int>(needle)));
+    } else {
+        const __m512i v = _mm512_loadu_si512(lanes);
+        return _mm512_cmpeq_epi64_mask(v, _mm512_set1_epi64(static_cast<long long>(needle)));
+    }
+}
+#endif
+
+template <uint64_t WIDTH, typename U>
+inline uint64_t match_vector(const U* lanes, U needle) {
+#if defined(__AVX512F__)
+    if constexpr (WIDTH == 64) {
+        return match_64(lanes, needle);
+    } else
+#endif
+#if defined(__AVX2__)
+    if constexpr (WIDTH == 32) {
+        return match_32(lanes, needle);
+    } else
+#endif
+    {
+        static_assert(WIDTH == 16);
+        return match_16(lanes, needle);
+    }
+}
+#elif defined(__aarch64__)
+inline constexpr uint64_t VECTOR_BYTES = 16;
+
+template <uint64_t WIDTH, typename U>
+inline uint64_t match_vector(const U* lanes, U needle) {
+    static_assert(WIDTH == 16);
+    if constexpr (sizeof(U) == 1) {
+        constexpr uint8_t BITS[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+        const uint8x16_t eq = vceqq_u8(vld1q_u8(lanes), vdupq_n_u8(needle));
+        const uint8x16_t bits = vandq_u8(eq, vld1q_u8(BITS));
+        return vaddv_u8(vget_low_u8(bits)) | (uint64_t{vaddv_u8(vget_high_u8(bits))} << 8);
+    } else if constexpr (sizeof(U) == 2) {
+        constexpr uint16_t BITS[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+        const uint16x8_t eq = vceqq_u16(vld1q_u16(lanes), vdupq_n_u16(needle));
+        return vaddvq_u16(vandq_u16(eq, vld1q_u16(BITS)));
+    } else if constexpr (sizeof(U) == 4) {
+        constexpr uint32_t BITS[4] = {1, 2, 4, 8};
+        const uint32x4_t eq = vceqq_u32(vld1q_u32(lanes), vdupq_n_u32(needle));
+        return vaddvq_u32(vandq_u32(eq, vld1q_u32(BITS)));
+    } else {
+        constexpr uint64_t BITS[2] = {1, 2};
+        const uint64x2_t eq = vceqq_u64(vld1q_u64(lanes), vdupq_n_u64(needle));
+        return vaddvq_u64(vandq_u64(eq, vld1q_u64(BITS)));
+    }
+}
+#endif
+
+// Widest vector that evenly divides a bucket of `bytes`.
+consteval uint64_t chunk_width(uint64_t bytes) {
+    uint64_t width = VECTOR_BYTES;
+    while (bytes % width != 0)
+        width /= 2;
+    return width;
+}
+
+// Bit i is set iff lanes[i] == needle.
+template <typename T, uint64_t LANES>
+inline uint64_t match(const T* lanes, T needle) {
+    static_assert(LANES > 0 && LANES < 64);
+    if constexpr (has_vector_probe<T, LANES>) {
+        using U = std::make_unsigned_t<T>;
+        constexpr uint64_t WIDTH = chunk_width(sizeof(T) * LANES);
+        constexpr uint64_t PER_CHUNK = WIDTH / sizeof(T);
+        const U* u = reinterpret_cast<const U*>(lanes);
+        const U n = static_cast<U>(needle);
+        uint64_t mask = 0;
+        for (uint64_t c = 0; c < LANES; c += PER_CHUNK)
+            mask |= match_vector<WIDTH>(u + c, n) << c;
+        return mask;
+    } else if constexpr (sizeof(T) == 1 && LANES <= 8) {
+        // SWAR: exact zero-byte test on `lanes ^ needle`, then gather the byte flags into bits.
+        constexpr uint64_t LOW = 0x7F7F7F7F7F7F7F7FULL;
+        uint64_t word = 0;
+        std::memcpy(&word, lanes, LANES);
+        uint64_t x = word ^ (0x0101010101010101ULL * static_cast<uint8_t>(needle));
+        uint64_t zero = ~(((x & LOW) + LOW) | x | LOW);
+        uint64_t mask = ((zero >> 7) * 0x0102040810204080ULL) >> 56;
+        return mask & ((uint64_t{1} << LANES) - 1);
+    } else {
+        uint64_t mask = 0;
+        for (uint64_t i = 0; i < LANES; i++)
+            mask |= static_cast<uint64_t>(lanes[i] == needle) << i;
+        return mask;
+    }
+}
+
+#if defined(__AVX2__)
+// Sum of the 64- or 32-bit lanes of `v`.
+template <typename U>
+inline U horizontal_sum(__m256i v) {
+    if constexpr (sizeof(U) == 8) {
+        const __m128i sum =
+            _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        return static_cast<U>(_mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1));
+    } else {
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return static_cast<U>(_mm_cvtsi128_si32(sum));
+    }
+}
+#endif
+
+// Sum of the first WIDTH / sizeof(U) lanes whose bit is set in `mask`. Lanes outside the mask are
+// never added, so they may hold anything.
+template <uint64_t WIDTH, typename U>
+inline U masked_sum_vector(const U* lanes, uint64_t mask) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    if constexpr (WIDTH == 64) {
+        // Two zero-masked 256-bit loads rather than one 512-bit load and _mm512_reduce_add_*,
+        // whose GCC 12 expansion trips -Wmaybe-uninitialized.
+        constexpr uint64_t HALF = 32 / sizeof(U);
+        constexpr uint64_t HALF_MASK = (uint64_t{1} << HALF) - 1;
+        if constexpr (sizeof(U) == 8) {
+            return horizontal_sum<U>(_mm256_add_epi64(
+                _mm256_maskz_loadu_epi64(static_cast<__mmask8>(mask & HALF_MASK), lanes),
+                _mm256_maskz_loadu_epi64(
+                    static_cast<__mmask8>((mask >> HALF) & HALF_MASK), lanes + HALF)));
+        } else {
+            return horizontal_sum<U>(_mm256_add_epi32(
+                _mm256_maskz_loadu_epi32(static_cast<__mmask8>(mask & HALF_MASK), lanes),
+                _mm256_maskz_loadu_epi32(
+                    static_cast<__mmask8>((mask >> HALF) & HALF_MASK), lanes + HALF)));
+        }
+    } else
+#endif
+#if defined(__AVX2__)
+    if constexpr (WIDTH == 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+        if constexpr (sizeof(U) == 8) {
+            // Spread the mask bits over the lanes and turn them into all-ones lanes.
+            const __m256i bits = _mm256_setr_epi64x(1, 2, 4, 8);
+            const __m256i live = _mm256_cmpeq_epi64(
+                _mm256_and_si256(_mm256_set1_epi64x(static_cast<long long>(mask)), bits), bits);
+            return horizontal_sum<U>(_mm256_and_si256(v, live));
+        } else {
+            const __m256i bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+            const __m256i live = _mm256_cmpeq_epi32(
+                _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(mask & 0xFF)), bits), bits);
+            return horizontal_sum<U>(_mm256_and_si256(v, live));
+        }
+    } else
+#endif
+    {
+        // Branch-free, which compilers turn into the native vector width on their own.
+        U sum = 0;
+        for (uint64_t i = 0; i < WIDTH / sizeof(U); i++)
+            sum += lanes[i] & (U{0} - static_cast<U>((mask >> i) & 1));
+        return sum;
+    }
+}
+
+// Sum of lanes[i] over the set bits of `mask`.
+template <typename T, uint64_t LANES>
+inline T masked_sum(const T* lanes, uint64_t mask) {
+    static_assert(LANES > 0 && LANES < 64);
+    if constexpr (std::is_integral_v<T> && (sizeof(T) == 4 || sizeof(T) == 8)) {
+        using U = std::make_unsigned_t<T>;
+        constexpr uint64_t WIDTH = chunk_width(sizeof(T) * LANES);
+        constexpr uint64_t PER_CHUNK = WIDTH / sizeof(T);
+        const U* u = reinterpret_cast<const U*>(lanes);
+        U sum = 0;
+        for (uint64_t c = 0; c < LANES; c += PER_CHUNK)
+            sum += masked_sum_vector<WIDTH>(u + c, mask >> c);
+        return static_cast<T>(sum);
+    } else {
+        T sum{};
+        for (; mask; mask &= mask - 1)
+            sum += lanes[static_cast<uint64_t>(std::countr_zero(mask))];
+        return sum;
+    }
+}
+
+// Packs bits 0, 2, 4, ... of `mask` into bits 0, 1, 2, ...
+inline uint64_t even_lanes(uint64_t mask) {
+    mask &= 0x5555555555555555ULL;
+    mask = (mask | (mask >> 1)) & 0x3333333333333333ULL;
+    mask = (mask | (mask >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+    mask = (mask | (mask >> 4)) & 0x00FF00FF00FF00FFULL;
+    mask = (mask | (mask >> 8)) & 0x0000FFFF0000FFFFULL;
+    mask = (mask | (mask >> 16)) & 0x00000000FFFFFFFFULL;
+    return mask;
+}
+
+// Index of the lowest set lane, or LANES when the mask is empty.
+template <uint64_t LANES>
+inline uint64_t first(uint64_t mask) {
+    return static_cast<uint64_t>(std::countr_zero(mask | (uint64_t{1} << LANES)));
+}
+
+} // namespace simd
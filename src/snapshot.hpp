@@ -0,0 +1,203 @@
+#pragma once
+
+#include "base.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+// File format behind TwoWay::save / open_mapped: a Header in the first HEADER_BYTES, then the
+// arrays the table is made of, each padded to a cache line, in native byte order. Loading only
+// parses the header; the arrays are used in place from a read-only mapping of the file.
+namespace snapshot {
+
+inline constexpr char MAGIC[8] = {'T', 'W', 'O', 'W', 'A', 'Y', 'S', 'N'};
+inline constexpr uint32_t VERSION = 1;
+// One page, so every section of the mapping starts page- and cache-line aligned.
+inline constexpr uint64_t HEADER_BYTES = 4096;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t bucket;
+    uint64_t key_bytes;
+    uint64_t value_bytes;
+    uint64_t tags;
+    // Fingerprint of TableTrait::hash, a snapshot is useless under any other hash.
+    uint64_t hash_identity;
+    uint64_t stash_size;
+    // Everything after the header, and its checksum.
+    uint64_t payload_bytes;
+    uint64_t checksum;
+};
+
+inline uint64_t padded(uint64_t bytes) {
+    return (bytes + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+// Four independent multiply-rotate lanes over 8-byte words, so verifying a mapping runs at
+// close to memory bandwidth. `bytes` must be a multiple of 32, which padded sections are.
+inline uint64_t checksum(const std::byte* data, uint64_t bytes) {
+    constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    uint64_t lanes[4] = {PRIME_1, PRIME_2, ~PRIME_1, ~PRIME_2};
+    for (uint64_t at = 0; at < bytes; at += 32) {
+        for (uint64_t lane = 0; lane < 4; lane++) {
+            uint64_t word;
+            std::memcpy(&word, data + at + lane * 8, sizeof(word));
+            lanes[lane] = std::rotl(lanes[lane] + word * PRIME_2, 31) * PRIME_1;
+        }
+    }
+    uint64_t sum = bytes;
+    for (const auto lane : lanes)
+        sum = squirrel3(sum ^ lane);
+    return sum;
+}
+
+// A whole file mapped read-only; empty if it could not be opened or mapped.
+class Mapping {
+public:
+    Mapping() = default;
+    explicit Mapping(const char* path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return;
+        map(fd);
+        ::close(fd);
+    }
+    // Maps an open descriptor, which stays open.
+    explicit Mapping(int fd) {
+        map(fd);
+    }
+    Mapping(Mapping&& other) noexcept
+        : base(std::exchange(other.base, nullptr)), bytes(std::exchange(other.bytes, 0)) {}
+    Mapping& operator=(Mapping&& other) noexcept {
+        std::swap(base, other.base);
+        std::swap(bytes, other.bytes);
+        return *this;
+    }
+    ~Mapping() {
+        if (base)
+            ::munmap(base, bytes);
+    }
+
+    explicit operator bool() const {
+        return base != nullptr;
+    }
+    std::byte* data() const {
+        return base;
+    }
+    uint64_t size() const {
+        return bytes;
+    }
+
+private:
+    void map(int fd) {
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || info.st_size <= 0)
+            return;
+        void* memory =
+            ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED)
+            return;
+        base = static_cast<std::byte*>(memory);
+        bytes = static_cast<uint64_t>(info.st_size);
+    }
+
+    std::byte* base = nullptr;
+    uint64_t bytes = 0;
+};
+
+// Writes the sections after a zeroed header page, then checksums what landed on disk and
+// fills in the header last, so a torn write never carries a valid header.
+//
+// All of it goes to `path` + ".tmp", which finish() renames over `path` once it is synced. The
+// old snapshot stays intact until then, and processes that still have it mapped keep their
+// pages: the rename only swaps the directory entry, it never truncates the file under them.
+class Writer {
+public:
+    explicit Writer(const char* path)
+        : target(path), temporary(target + ".tmp"),
+          fd(::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)) {
+        static constexpr std::byte ZEROS[HEADER_BYTES]{};
+        ok = fd >= 0 && write(ZEROS, HEADER_BYTES);
+    }
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer() {
+        if (fd >= 0)
+            ::close(fd);
+        if (!renamed)
+            ::unlink(temporary.c_str());
+    }
+
+    // Appends `bytes` of `memory`, zero-padded to a cache line.
+    void section(const void* memory, uint64_t bytes) {
+        static constexpr std::byte ZEROS[CACHE_LINE]{};
+        ok = ok && write(memory, bytes) && write(ZEROS, padded(bytes) - bytes);
+        payload += padded(bytes);
+    }
+
+    // Fills in payload_bytes and checksum and moves the file into place; false if anything
+    // failed along the way, in which case `path` is left as it was.
+    bool finish(Header header) {
+        if (!ok || ::fsync(fd) != 0)
+            return false;
+        Mapping written{fd};
+        if (!written || written.size() != HEADER_BYTES + payload)
+            return false;
+        header.payload_bytes = payload;
+        header.checksum = checksum(written.data() + HEADER_BYTES, payload);
+        if (::pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            ::fsync(fd) != 0 || ::rename(temporary.c_str(), target.c_str()) != 0)
+            return false;
+        renamed = true;
+        return sync_directory();
+    }
+
+private:
+    // Makes the rename itself durable.
+    bool sync_directory() {
+        const auto slash = target.rfind('/');
+        const std::string directory =
+            slash == std::string::npos ? "." : slash == 0 ? "/" : target.substr(0, slash);
+        int directory_fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (directory_fd < 0)
+            return false;
+        bool synced = ::fsync(directory_fd) == 0;
+        ::close(directory_fd);
+        return synced;
+    }
+
+    bool write(const void* memory, uint64_t bytes) {
+        const auto* at = static_cast<const std::byte*>(memory);
+        while (bytes > 0) {
+            ssize_t written = ::write(fd, at, bytes);
+            if (written <= 0)
+                return false;
+            at += written;
+            bytes -= static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    std::string target;
+    std::string temporary;
+    int fd;
+    bool ok = false;
+    bool renamed = false;
+    uint64_t payload = 0;
+};
+
+} // namespace snapshot
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Lookup instrumentation policies for TwoWay and StringTwoWay. Every lookup reports where it
+// ended through hit() or miss(); the policy decides what, if anything, is recorded.
+//
+// Occupancy is what TwoWay::stats() reports about the entries themselves, no lookups needed.
+namespace stats {
+
+// Where a hit was found.
+enum Choice : uint64_t { FIRST = 0, SECOND = 1, STASH = 2 };
+
+// The default: empty inline hooks and no state, so lookups compile to the uninstrumented code.
+struct Off {
+    static constexpr bool ENABLED = false;
+
+    void hit(Choice, uint64_t, uint64_t) {}
+    void miss() {}
+};
+
+// Histograms of resolved lookups. A hit's probe length is its position in the order a scalar
+// probe would compare lanes, alternating between the two buckets (2 * lane, + 1 in the second
+// bucket) and then the stash after both full buckets.
+struct Probes {
+    static constexpr bool ENABLED = true;
+    // Longer probes and higher lanes land in the last slot.
+    static constexpr uint64_t MAX_LANE = 64;
+    static constexpr uint64_t MAX_LENGTH = 2 * MAX_LANE + 8;
+
+    void hit(Choice choice, uint64_t lane, uint64_t length) {
+        choices[choice]++;
+        lanes[std::min(lane, MAX_LANE - 1)]++;
+        lengths[std::min(length, MAX_LENGTH - 1)]++;
+    }
+    void miss() {
+        misses++;
+    }
+
+    uint64_t hits() const {
+        return choices[FIRST] + choices[SECOND] + choices[STASH];
+    }
+
+    double mean_length() const {
+        uint64_t total = 0;
+        for (uint64_t length = 0; length < MAX_LENGTH; length++)
+            total += length * lengths[length];
+        return hits() ? static_cast<double>(total) / static_cast<double>(hits()) : 0.0;
+    }
+
+    // Smallest probe length at least `fraction` of the hits did not exceed.
+    uint64_t length_quantile(double fraction) const {
+        uint64_t seen = 0;
+        for (uint64_t length = 0; length < MAX_LENGTH; length++) {
+            seen += lengths[length];
+            if (static_cast<double>(seen) >= fraction * static_cast<double>(hits()))
+                return length;
+        }
+        return MAX_LENGTH - 1;
+    }
+
+    void clear() {
+        *this = Probes{};
+    }
+
+    std::array<uint64_t, 3> choices{};
+    uint64_t misses = 0;
+    std::array<uint64_t, MAX_LANE> lanes{};
+    std::array<uint64_t, MAX_LENGTH> lengths{};
+};
+
+// A snapshot of how full a table is and where its entries sit.
+struct Occupancy {
+    uint64_t size = 0;
+    uint64_t buckets = 0;
+    double load_factor = 0.0;
+    // fill[k] = buckets holding exactly k entries, for k = 0..BUCKET.
+    std::vector<uint64_t> fill;
+    // Share of the entries that sit in their second bucket, and entries in the stash.
+    double second_fraction = 0.0;
+    uint64_t stashed = 0;
+    // Mean probe length (as Probes counts it) of looking every entry up once.
+    double hit_cost = 0.0;
+    // Mean number of entries a lookup of an absent key has to rule out: the occupied lanes of
+    // two random buckets plus the stash.
+    double miss_cost = 0.0;
+    double bytes_per_entry = 0.0;
+};
+
+} // namespace stats
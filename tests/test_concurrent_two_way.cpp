@@ -0,0 +1,135 @@
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ConcurrentTwoWay.hpp"
+
+struct U64ToU64TableTrait {
+    using Key = uint64_t;
+    using Value = uint64_t;
+
+    static uint64_t hash(Key key) {
+        return squirrel3(key);
+    }
+};
+
+TEST(ConcurrentTwoWay, InsertFindErase) {
+    ConcurrentTwoWay<U64ToU64TableTrait, 4> map;
+
+    for (uint64_t i = 1; i <= 5000; i++) {
+        EXPECT_TRUE(map.insert(i, i * 2));
+    }
+    EXPECT_FALSE(map.insert(7, 0));
+    EXPECT_EQ(map.size(), 5000u);
+    for (uint64_t i = 1; i <= 5000; i++) {
+        EXPECT_EQ(map.find(i), i * 2);
+    }
+    EXPECT_FALSE(map.contains(0));
+
+    EXPECT_TRUE(map.erase(7));
+    EXPECT_FALSE(map.erase(7));
+    EXPECT_FALSE(map.contains(7));
+    EXPECT_EQ(map.size(), 4999u);
+}
+
+TEST(ConcurrentTwoWay, ReadersSeeStableKeysWhileWriterGrows) {
+    ConcurrentTwoWay<U64ToU64TableTrait, 4> map;
+    constexpr uint64_t STABLE = 1000;
+    constexpr uint64_t ADDED = 50'000;
+    for (uint64_t i = 1; i <= STABLE; i++) {
+        map.insert(i, i * 3);
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> errors{0};
+    std::vector<std::thread> readers{};
+    for (uint64_t t = 0; t < 3; t++) {
+        readers.emplace_back([&, t] {
+            uint64_t key = t;
+            while (!done.load()) {
+                key = key % STABLE + 1;
+                if (map.find(key) != key * 3)
+                    errors.fetch_add(1);
+                // Keys the writer adds are either absent or complete.
+                const auto added = map.find(STABLE + key * 37 % ADDED + 1);
+                if (added && *added != (STABLE + key * 37 % ADDED + 1) * 3)
+                    errors.fetch_add(1);
+            }
+        });
+    }
+
+    for (uint64_t i = STABLE + 1; i <= STABLE + ADDED; i++) {
+        map.insert(i, i * 3);
+    }
+    for (uint64_t i = STABLE + 1; i <= STABLE + ADDED; i += 2) {
+        map.erase(i);
+    }
+    done.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(errors.load(), 0u);
+    EXPECT_EQ(map.size(), STABLE + ADDED / 2);
+    for (uint64_t i = STABLE + 2; i <= STABLE + ADDED; i += 2) {
+        EXPECT_EQ(map.find(i), i * 3);
+    }
+}
+
+TEST(ConcurrentTwoWay, ReadersBeyondTheSlotTableShareACounter) {
+    ConcurrentTwoWay<U64ToU64TableTrait, 4> map;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        map.insert(i, i * 3);
+    }
+
+    // Occupy every private slot so the readers below have to share.
+    std::atomic<bool> release{false};
+    std::atomic<uint64_t> holding{0};
+    std::vector<std::thread> holders{};
+    for (uint64_t t = 0; t < ReaderSlot::capacity(); t++) {
+        holders.emplace_back([&] {
+            ReaderSlot::current();
+            holding.fetch_add(1);
+            while (!release.load()) {
+                std::this_thread::yield();
+            }
+        });
+    }
+    while (holding.load() < ReaderSlot::capacity()) {
+        std::this_thread::yield();
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> shared{0};
+    std::vector<std::thread> readers{};
+    for (uint64_t t = 0; t < 2; t++) {
+        readers.emplace_back([&, t] {
+            shared.fetch_add(ReaderSlot::current() == ReaderSlot::SHARED);
+            uint64_t key = t;
+            while (!done.load()) {
+                key = key % 1000 + 1;
+                if (map.find(key) != key * 3)
+                    errors.fetch_add(1);
+            }
+        });
+    }
+    for (uint64_t i = 1001; i <= 20'000; i++) {
+        map.insert(i, i * 3);
+    }
+    done.store(true);
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    release.store(true);
+    for (auto& holder : holders) {
+        holder.join();
+    }
+
+    EXPECT_EQ(shared.load(), 2u);
+    EXPECT_EQ(errors.load(), 0u);
+    EXPECT_EQ(map.size(), 20'000u);
+}
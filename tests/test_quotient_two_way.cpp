@@ -0,0 +1,107 @@
+#include <cstdint>
+#include <map>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "QuotientTwoWay.hpp"
+
+TEST(QuotientTwoWay, PermutationIsInvertible) {
+    static_assert(unpermute<24>(permute<24>(12345)) == 12345);
+    for (uint64_t key = 0; key < (1 << 12); key++) {
+        EXPECT_EQ(permute<12>(key) >> 12, 0u);
+        EXPECT_EQ(unpermute<12>(permute<12>(key)), key);
+    }
+    std::mt19937_64 rng{7};
+    for (int i = 0; i < 10000; i++) {
+        const uint64_t key = rng();
+        EXPECT_EQ(unpermute<64>(permute<64>(key)), key);
+        EXPECT_EQ(unpermute<40>(permute<40>(key >> 24)), key >> 24);
+    }
+}
+
+TEST(QuotientTwoWay, LaneWidthsSetTheSmallestTable) {
+    using Narrow = QuotientTwoWay<uint64_t, 24, uint16_t>;
+    using Wide = QuotientTwoWay<uint64_t, 40, uint32_t>;
+    static_assert(Narrow::MIN_BUCKET_BITS == 9);
+    static_assert(Wide::MIN_BUCKET_BITS == 9);
+    static_assert(QuotientTwoWay<uint64_t, 16, uint32_t>::MIN_BUCKET_BITS == 3);
+    static_assert(sizeof(Narrow::Slot::lanes) == CACHE_LINE);
+    static_assert(sizeof(Wide::Slot::lanes) == CACHE_LINE);
+
+    Narrow map;
+    EXPECT_EQ(map.capacity, 512u);
+}
+
+template <typename Map>
+void expect_behaves_like_std_map(uint64_t key_limit) {
+    Map map;
+    std::map<uint64_t, uint64_t> expected{};
+    std::mt19937_64 rng{11};
+    for (uint64_t i = 0; i < 100'000; i++) {
+        const uint64_t key = rng() % key_limit;
+        if (!expected.contains(key)) {
+            map.insert(key, i);
+            expected[key] = i;
+        }
+    }
+    for (uint64_t i = 0; i < 1000; i++) {
+        const uint64_t key = rng() % key_limit;
+        map.erase(key);
+        expected.erase(key);
+    }
+    EXPECT_EQ(map.size(), expected.size());
+    for (const auto& [key, value] : expected) {
+        ASSERT_NE(map.find_ptr(key), nullptr) << key;
+        EXPECT_EQ(map.find(key), value);
+    }
+    uint64_t misses = 0;
+    for (uint64_t i = 0; i < 10'000; i++) {
+        const uint64_t key = rng() % key_limit;
+        EXPECT_EQ(map.contains(key), expected.contains(key)) << key;
+        misses += !expected.contains(key);
+    }
+    EXPECT_GT(misses, 0u);
+
+    uint64_t visited = 0;
+    map.for_each([&](uint64_t key, uint64_t value) {
+        EXPECT_EQ(expected.at(key), value);
+        visited++;
+    });
+    EXPECT_EQ(visited, expected.size());
+}
+
+TEST(QuotientTwoWay, MatchesStdMapAcrossGrowth) {
+    expect_behaves_like_std_map<QuotientTwoWay<uint64_t, 24, uint16_t>>(1 << 24);
+    expect_behaves_like_std_map<QuotientTwoWay<uint64_t, 18, uint16_t>>(1 << 17);
+    expect_behaves_like_std_map<QuotientTwoWay<uint64_t, 40, uint32_t>>(1ULL << 40);
+    expect_behaves_like_std_map<QuotientTwoWay<uint64_t, 20, uint32_t, 4>>(1 << 20);
+}
+
+TEST(QuotientTwoWay, DenseKeysFillWideBuckets) {
+    QuotientTwoWay<uint32_t, 24> map;
+    for (uint64_t key = 1; key <= 1 << 20; key++) {
+        map.insert(key, static_cast<uint32_t>(key));
+    }
+    EXPECT_GT(map.load_factor(), 0.45);
+    for (uint64_t key = 1; key <= 1 << 20; key++) {
+        ASSERT_EQ(map.find(key), key);
+    }
+    EXPECT_FALSE(map.contains(0));
+    EXPECT_FALSE(map.contains((1 << 20) + 1));
+    map.clear();
+    EXPECT_EQ(map.size(), 0u);
+    EXPECT_FALSE(map.contains(1));
+}
+
+#ifndef NDEBUG
+TEST(QuotientTwoWayDeathTest, KeysPastKeyBitsAssert) {
+    QuotientTwoWay<uint64_t, 24> map;
+    map.insert(5, 1);
+    // 5 + 2^24 has the same low 24 bits as 5, so without the check it would alias it.
+    EXPECT_DEATH(map.insert(5 + (1 << 24), 2), "in_range");
+    EXPECT_DEATH(map.find_ptr(5 + (1 << 24)), "in_range");
+    EXPECT_DEATH(map.erase(5 + (1 << 24)), "in_range");
+    EXPECT_EQ(map.find(5), 1u);
+}
+#endif
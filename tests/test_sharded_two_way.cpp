@@ -0,0 +1,76 @@
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ShardedTwoWay.hpp"
+
+struct U64ToU64TableTrait {
+    using Key = uint64_t;
+    using Value = uint64_t;
+
+    static uint64_t hash(Key key) {
+        return squirrel3(key);
+    }
+};
+
+TEST(ShardedTwoWay, InsertFindErase) {
+    ShardedTwoWay<U64ToU64TableTrait, 4, 8> map;
+
+    for (uint64_t i = 1; i <= 5000; i++) {
+        map.insert(i, i * 2);
+    }
+    EXPECT_EQ(map.size(), 5000u);
+    for (uint64_t i = 1; i <= 5000; i++) {
+        EXPECT_EQ(map.find(i), i * 2);
+    }
+    EXPECT_EQ(map.find(0), std::nullopt);
+
+    map.erase(7);
+    EXPECT_FALSE(map.contains(7));
+    EXPECT_EQ(map.size(), 4999u);
+}
+
+TEST(ShardedTwoWay, BatchesMatchSingleKeyCalls) {
+    ShardedTwoWay<U64ToU64TableTrait, 4, 16> map;
+    std::vector<uint64_t> keys{};
+    std::vector<uint64_t> values{};
+    for (uint64_t i = 1; i <= 3000; i++) {
+        keys.emplace_back(i);
+        values.emplace_back(i + 11);
+    }
+    map.insert_many(keys, values);
+    EXPECT_EQ(map.size(), keys.size());
+
+    std::vector<uint64_t> lookups{};
+    for (uint64_t i = 0; i <= 4000; i += 3) {
+        lookups.emplace_back(i);
+    }
+    std::vector<uint64_t> out(lookups.size());
+    map.find_many(lookups, out);
+    for (size_t i = 0; i < lookups.size(); i++) {
+        EXPECT_EQ(out[i], map.find(lookups[i]).value_or(0));
+    }
+}
+
+TEST(ShardedTwoWay, ConcurrentWritersKeepEveryKey) {
+    ShardedTwoWay<U64ToU64TableTrait> map;
+    constexpr uint64_t PER_THREAD = 20'000;
+    std::vector<std::thread> writers{};
+    for (uint64_t t = 0; t < 4; t++) {
+        writers.emplace_back([&, t] {
+            for (uint64_t i = t * PER_THREAD; i < (t + 1) * PER_THREAD; i++) {
+                map.insert(i, i ^ 0xFF);
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+
+    EXPECT_EQ(map.size(), 4 * PER_THREAD);
+    for (uint64_t i = 0; i < 4 * PER_THREAD; i++) {
+        EXPECT_EQ(map.find(i), i ^ 0xFF);
+    }
+}
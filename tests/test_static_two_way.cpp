@@ -0,0 +1,78 @@
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include <gtest/gtest.h>
+
+#include "StaticTwoWay.hpp"
+
+struct U64ToU64TableTrait {
+    using Key = uint64_t;
+    using Value = uint64_t;
+
+    static constexpr uint64_t hash(Key key) {
+        return squirrel3(key);
+    }
+};
+
+struct U32ToU32TableTrait {
+    using Key = uint32_t;
+    using Value = uint32_t;
+
+    static constexpr uint64_t hash(Key key) {
+        return squirrel3(key);
+    }
+};
+
+constexpr std::array<std::pair<uint32_t, uint32_t>, 5> OPCODES{{
+    {0x01, 100},
+    {0x02, 200},
+    {0x10, 300},
+    {0x7F, 400},
+    {0xFF, 500},
+}};
+constexpr auto OPCODE_TABLE = make_static_two_way<U32ToU32TableTrait>(OPCODES);
+
+template <size_t N>
+consteval std::array<std::pair<uint64_t, uint64_t>, N> make_entries() {
+    std::array<std::pair<uint64_t, uint64_t>, N> entries{};
+    for (uint64_t i = 0; i < N; i++) {
+        entries[i] = {i * 3 + 1, i * 7};
+    }
+    return entries;
+}
+
+constexpr auto ENTRIES = make_entries<3000>();
+constexpr auto LARGE_TABLE = make_static_two_way<U64ToU64TableTrait>(ENTRIES);
+constinit auto NARROW_TABLE = make_static_two_way<U64ToU64TableTrait, 4, 1024>(ENTRIES);
+
+TEST(StaticTwoWay, AnswersAtCompileTime) {
+    static_assert(OPCODE_TABLE.size() == OPCODES.size());
+    static_assert(OPCODE_TABLE.find(0x10) == 300);
+    static_assert(OPCODE_TABLE.find(0xFF) == 500);
+    static_assert(!OPCODE_TABLE.contains(0x03));
+    static_assert(LARGE_TABLE.find(2998) == 999 * 7);
+    static_assert(std::is_same_v<
+                  decltype(NARROW_TABLE),
+                  StaticTwoWay<U64ToU64TableTrait, 4, 1024>>);
+    EXPECT_EQ(OPCODE_TABLE.find(0x7F), 400u);
+    EXPECT_EQ(OPCODE_TABLE.find_ptr(0x80), nullptr);
+}
+
+TEST(StaticTwoWay, SizedLikeReserve) {
+    using Reserved = TwoWay<U64ToU64TableTrait>;
+    EXPECT_EQ(std::size(LARGE_TABLE.slots), Reserved::buckets_for(ENTRIES.size()));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(&LARGE_TABLE.slots[0]) % CACHE_LINE, 0u);
+    EXPECT_GT(LARGE_TABLE.load_factor(), 0.85);
+}
+
+TEST(StaticTwoWay, RuntimeLookupsMatchEntries) {
+    for (const auto& [key, value] : ENTRIES) {
+        ASSERT_NE(LARGE_TABLE.find_ptr(key), nullptr) << key;
+        EXPECT_EQ(LARGE_TABLE.find(key), value);
+        EXPECT_EQ(NARROW_TABLE.find(key), value);
+        EXPECT_FALSE(LARGE_TABLE.contains(key + 1));
+        EXPECT_FALSE(NARROW_TABLE.contains(key + 2));
+    }
+    EXPECT_EQ(LARGE_TABLE.size(), ENTRIES.size());
+}
@@ -0,0 +1,77 @@
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "StringTwoWay.hpp"
+
+struct StringToU64TableTrait {
+    using Value = uint64_t;
+
+    static uint64_t hash(std::string_view key) {
+        return std::hash<std::string_view>{}(key);
+    }
+};
+
+// Every key gets the same hash, so lookups have to fall back to comparing bytes.
+struct ConstantHashTableTrait {
+    using Value = uint64_t;
+
+    static uint64_t hash(std::string_view) {
+        return 42;
+    }
+};
+
+TEST(StringTwoWay, InsertFindErase) {
+    StringTwoWay<StringToU64TableTrait, 4> map;
+    std::vector<std::string> keys{};
+    for (uint64_t i = 0; i < 3000; i++) {
+        keys.emplace_back(std::string(i % 80, 'x') + std::to_string(i));
+    }
+    for (uint64_t i = 0; i < keys.size(); i++) {
+        map.insert(keys[i], i);
+    }
+    map.insert("", 7777);
+
+    EXPECT_EQ(map.size(), keys.size() + 1);
+    for (uint64_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(map.find(keys[i]), i);
+    }
+    EXPECT_EQ(map.find(""), 7777u);
+    EXPECT_FALSE(map.contains("missing"));
+    EXPECT_FALSE(map.contains(keys[5] + "x"));
+
+    map.erase(keys[5]);
+    EXPECT_FALSE(map.contains(keys[5]));
+    EXPECT_EQ(map.find(keys[6]), 6u);
+
+    map.clear();
+    EXPECT_EQ(map.size(), 0u);
+    EXPECT_FALSE(map.contains(keys[6]));
+}
+
+TEST(StringTwoWay, EqualHashesCompareBytes) {
+    StringTwoWay<ConstantHashTableTrait, 8> map;
+    map.insert("apple", 1);
+    map.insert("apples", 2);
+    map.insert("pear", 3);
+
+    EXPECT_EQ(map.find("apple"), 1u);
+    EXPECT_EQ(map.find("apples"), 2u);
+    EXPECT_EQ(map.find("pear"), 3u);
+    EXPECT_EQ(map.find_ptr("peach"), nullptr);
+}
+
+TEST(StringTwoWay, KeysPastFourGiBThrow) {
+    StringTwoWay<StringToU64TableTrait, 4> map;
+    map.insert("apple", 1);
+    // Only the length is looked at before the check throws, the bytes are never read.
+    const char bytes[] = "pear";
+    std::string_view huge{bytes, uint64_t{1} << 32};
+    EXPECT_THROW(map.insert(huge, 2), std::length_error);
+    EXPECT_EQ(map.size(), 1u);
+    EXPECT_EQ(map.find("apple"), 1u);
+}
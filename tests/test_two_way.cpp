@@ -1,4 +1,17 @@
+#include <bit>
 #include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <string>
+#include <utility>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include <gtest/gtest.h>
 
@@ -41,29 +54,22 @@ struct U64ToU64TableTrait {
 
 TEST(TwoWay, InsertFindContains) {
     TwoWay<Int32ToU32TableTrait, 4> map;
-    uint64_t steps = 0;
 
     map.insert(1, 10);
     map.insert(-2, 20);
     map.insert(7, 30);
 
-    EXPECT_TRUE(map.contains(1, &steps));
-    steps = 0;
-    EXPECT_TRUE(map.contains(-2, &steps));
-    steps = 0;
-    EXPECT_TRUE(map.contains(7, &steps));
+    EXPECT_TRUE(map.contains(1));
+    EXPECT_TRUE(map.contains(-2));
+    EXPECT_TRUE(map.contains(7));
 
-    steps = 0;
-    EXPECT_EQ(map.find(1, &steps), 10u);
-    steps = 0;
-    EXPECT_EQ(map.find(-2, &steps), 20u);
-    steps = 0;
-    EXPECT_EQ(map.find(7, &steps), 30u);
+    EXPECT_EQ(map.find(1), 10u);
+    EXPECT_EQ(map.find(-2), 20u);
+    EXPECT_EQ(map.find(7), 30u);
 }
 
 TEST(TwoWay, EraseRemovesKey) {
     TwoWay<U64ToU64TableTrait, 4> map;
-    uint64_t steps = 0;
 
     map.insert(1, 100);
     map.insert(2, 200);
@@ -71,11 +77,9 @@ TEST(TwoWay, EraseRemovesKey) {
 
     map.erase(2);
 
-    EXPECT_FALSE(map.contains(2, &steps));
-    steps = 0;
-    EXPECT_TRUE(map.contains(1, &steps));
-    steps = 0;
-    EXPECT_TRUE(map.contains(3, &steps));
+    EXPECT_FALSE(map.contains(2));
+    EXPECT_TRUE(map.contains(1));
+    EXPECT_TRUE(map.contains(3));
 }
 
 TEST(TwoWay, GrowsAndSumsValues) {
@@ -90,42 +94,816 @@ TEST(TwoWay, GrowsAndSumsValues) {
     EXPECT_EQ(map.size(), 200u);
     EXPECT_EQ(map.sum_all_values(), expected_sum);
 
-    uint64_t steps = 0;
-    EXPECT_EQ(map.find(42, &steps), 51u);
+    EXPECT_EQ(map.find(42), 51u);
 }
 
 TEST(TwoWay, HandlesSignedKeysAndStructValues) {
     TwoWay<Int64ToPairTableTrait, 4> map;
-    uint64_t steps = 0;
 
     map.insert(-100, PairValue{1, 2});
     map.insert(5000, PairValue{3, 4});
 
-    EXPECT_TRUE(map.contains(-100, &steps));
-    steps = 0;
-    EXPECT_TRUE(map.contains(5000, &steps));
+    EXPECT_TRUE(map.contains(-100));
+    EXPECT_TRUE(map.contains(5000));
 
-    steps = 0;
-    EXPECT_EQ(map.find(-100, &steps), (PairValue{1, 2}));
-    steps = 0;
-    EXPECT_EQ(map.find(5000, &steps), (PairValue{3, 4}));
+    EXPECT_EQ(map.find(-100), (PairValue{1, 2}));
+    EXPECT_EQ(map.find(5000), (PairValue{3, 4}));
 }
 
 TEST(TwoWay, ClearAndReuse) {
     TwoWay<U64ToU64TableTrait, 4> map;
-    uint64_t steps = 0;
 
     map.insert(10, 100);
     map.insert(20, 200);
     map.clear();
 
-    EXPECT_FALSE(map.contains(10, &steps));
-    steps = 0;
-    EXPECT_FALSE(map.contains(20, &steps));
+    EXPECT_FALSE(map.contains(10));
+    EXPECT_FALSE(map.contains(20));
 
     map.insert(30, 300);
-    steps = 0;
-    EXPECT_TRUE(map.contains(30, &steps));
-    steps = 0;
-    EXPECT_EQ(map.find(30, &steps), 300u);
+    EXPECT_TRUE(map.contains(30));
+    EXPECT_EQ(map.find(30), 300u);
+}
+
+template <typename T, uint64_t LANES>
+void expect_match_agrees_with_scalar() {
+    T lanes[LANES];
+    for (uint64_t i = 0; i < LANES; i++) {
+        lanes[i] = i % 3 == 0 ? std::numeric_limits<T>::max() : static_cast<T>(i * 7);
+    }
+    for (uint64_t i = 0; i < LANES; i++) {
+        uint64_t expected = 0;
+        for (uint64_t j = 0; j < LANES; j++) {
+            expected |= static_cast<uint64_t>(lanes[j] == lanes[i]) << j;
+        }
+        EXPECT_EQ((simd::match<T, LANES>(lanes, lanes[i])), expected);
+    }
+    EXPECT_EQ((simd::match<T, LANES>(lanes, static_cast<T>(12345))), 0u);
+}
+
+TEST(TwoWay, ProbeKernelMatchesScalar) {
+    expect_match_agrees_with_scalar<uint32_t, 4>();
+    expect_match_agrees_with_scalar<uint32_t, 8>();
+    expect_match_agrees_with_scalar<uint32_t, 16>();
+    expect_match_agrees_with_scalar<int32_t, 12>();
+    expect_match_agrees_with_scalar<uint64_t, 2>();
+    expect_match_agrees_with_scalar<uint64_t, 4>();
+    expect_match_agrees_with_scalar<int64_t, 8>();
+    expect_match_agrees_with_scalar<uint64_t, 16>();
+    expect_match_agrees_with_scalar<uint16_t, 3>();
+    expect_match_agrees_with_scalar<uint16_t, 8>();
+    expect_match_agrees_with_scalar<uint16_t, 16>();
+    expect_match_agrees_with_scalar<int16_t, 24>();
+    expect_match_agrees_with_scalar<uint16_t, 32>();
+    expect_match_agrees_with_scalar<uint8_t, 4>();
+    expect_match_agrees_with_scalar<uint8_t, 8>();
+    expect_match_agrees_with_scalar<uint8_t, 16>();
+    expect_match_agrees_with_scalar<uint8_t, 32>();
+}
+
+TEST(TwoWay, WideBucketsFindEveryKey) {
+    TwoWay<U64ToU64TableTrait, 8> wide;
+    TwoWay<Int32ToU32TableTrait, 16> narrow;
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        wide.insert(i, i * 3);
+        narrow.insert(static_cast<int32_t>(i), static_cast<uint32_t>(i * 5));
+    }
+    for (uint64_t i = 1; i <= 1000; i++) {
+        EXPECT_EQ(wide.find(i), i * 3);
+        EXPECT_EQ(narrow.find(static_cast<int32_t>(i)), i * 5);
+    }
+    EXPECT_FALSE(wide.contains(1001));
+    EXPECT_FALSE(narrow.contains(-1));
+}
+
+TEST(TwoWay, DefaultBucketFillsCacheLine) {
+    static_assert(
+        std::is_same_v<TwoWay<U64ToU64TableTrait>, TwoWay<U64ToU64TableTrait, CACHE_LINE / 8>>);
+    static_assert(std::is_same_v<
+                  TwoWay<Int32ToU32TableTrait>,
+                  TwoWay<Int32ToU32TableTrait, CACHE_LINE / 4>>);
+
+    TwoWay<U64ToU64TableTrait> map;
+    for (uint64_t i = 1; i <= 1000; i++) {
+        map.insert(i, i + 7);
+    }
+    for (uint64_t i = 1; i <= 1000; i++) {
+        EXPECT_EQ(map.find(i), i + 7);
+    }
+}
+
+TEST(TwoWay, StoresEveryKeyValue) {
+    constexpr uint64_t MAX = std::numeric_limits<uint64_t>::max();
+    TwoWay<U64ToU64TableTrait, 4> map;
+    TwoWay<U64ToU64TableTrait, 4, true> tagged;
+
+    EXPECT_EQ(map.find_ptr(MAX), nullptr);
+    for (uint64_t i = 0; i < 500; i++) {
+        map.insert(MAX - i, i);
+        tagged.insert(MAX - i, i);
+    }
+    map.insert(0, 42);
+    for (uint64_t i = 0; i < 500; i++) {
+        EXPECT_EQ(map.find(MAX - i), i);
+        EXPECT_EQ(tagged.find(MAX - i), i);
+    }
+    EXPECT_EQ(map.find(0), 42u);
+
+    map.erase(MAX);
+    tagged.erase(MAX);
+    EXPECT_FALSE(map.contains(MAX));
+    EXPECT_FALSE(tagged.contains(MAX));
+    EXPECT_EQ(map.find(MAX - 1), 1u);
+
+    map.clear();
+    EXPECT_FALSE(map.contains(MAX - 1));
+    EXPECT_FALSE(map.contains(0));
+    EXPECT_EQ(map.sum_all_values(), 0u);
+}
+
+TEST(TwoWay, TaggedBucketsMatchUntagged) {
+    TwoWay<U64ToU64TableTrait, 4, true> tagged;
+    TwoWay<U64ToU64TableTrait, 4> plain;
+
+    for (uint64_t i = 1; i <= 2000; i++) {
+        tagged.insert(i, i * 11);
+        plain.insert(i, i * 11);
+    }
+    for (uint64_t i = 1; i <= 2000; i += 3) {
+        tagged.erase(i);
+        plain.erase(i);
+    }
+
+    EXPECT_EQ(tagged.size(), plain.size());
+    EXPECT_EQ(tagged.sum_all_values(), plain.sum_all_values());
+    for (uint64_t i = 1; i <= 2000; i++) {
+        EXPECT_EQ(tagged.contains(i), plain.contains(i));
+        if (i % 3 != 1) {
+            EXPECT_EQ(tagged.find(i), i * 11);
+        }
+    }
+
+    tagged.clear();
+    EXPECT_FALSE(tagged.contains(2));
+}
+
+template <typename Layout>
+void expect_layout_matches_split() {
+    TwoWay<U64ToU64TableTrait, 4, false, Layout> map;
+    TwoWay<Int64ToPairTableTrait, 8, false, Layout> pairs;
+
+    for (uint64_t i = 1; i <= 3000; i++) {
+        map.insert(i, i * 13);
+        pairs.insert(static_cast<int64_t>(i), PairValue{static_cast<uint32_t>(i), 1});
+    }
+    for (uint64_t i = 1; i <= 3000; i += 4) {
+        map.erase(i);
+        pairs.erase(static_cast<int64_t>(i));
+    }
+    for (uint64_t i = 1; i <= 3000; i++) {
+        EXPECT_EQ(map.contains(i), i % 4 != 1);
+        if (i % 4 != 1) {
+            EXPECT_EQ(map.find(i), i * 13);
+            EXPECT_EQ(
+                pairs.find(static_cast<int64_t>(i)),
+                (PairValue{static_cast<uint32_t>(i), 1}));
+        }
+    }
+    EXPECT_EQ(map.size(), 2250u);
+    EXPECT_EQ(pairs.size(), 2250u);
+}
+
+TEST(TwoWay, LayoutsAgree) {
+    expect_layout_matches_split<layout::Split>();
+    expect_layout_matches_split<layout::Interleaved>();
+    expect_layout_matches_split<layout::Separate>();
+}
+
+TEST(TwoWay, FindManyMatchesFind) {
+    TwoWay<U64ToU64TableTrait, 4> map;
+    for (uint64_t i = 1; i <= 5000; i++) {
+        map.insert(i, i * 2);
+    }
+
+    std::vector<uint64_t> keys{};
+    for (uint64_t i = 0; i < 100; i++) {
+        keys.push_back((i * 37) % 5000 + 1);
+    }
+    std::vector<uint64_t> values(keys.size());
+    map.find_many(std::span<const uint64_t>{keys}, std::span<uint64_t>{values});
+    for (size_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ(values[i], keys[i] * 2);
+    }
+
+    std::vector<uint64_t> small_group(3);
+    map.find_many<4>(std::span<const uint64_t>{keys}.first(3), std::span<uint64_t>{small_group});
+    EXPECT_EQ(small_group[2], keys[2] * 2);
+}
+
+TEST(TwoWay, ContainsManySetsHitBits) {
+    TwoWay<U64ToU64TableTrait, 4, true> map;
+    for (uint64_t i = 1; i <= 100; i++) {
+        map.insert(i, i);
+    }
+
+    std::vector<uint64_t> keys{};
+    for (uint64_t i = 0; i < 70; i++) {
+        keys.push_back(i % 2 == 0 ? i + 1 : i + 1000);
+    }
+    std::vector<uint64_t> hits(2);
+    map.contains_many(std::span<const uint64_t>{keys}, std::span<uint64_t>{hits});
+    for (uint64_t i = 0; i < keys.size(); i++) {
+        EXPECT_EQ((hits[i / 64] >> (i % 64)) & 1, i % 2 == 0 ? 1u : 0u);
+    }
+}
+
+TEST(TwoWay, CuckooDisplacementDefersGrowth) {
+    TwoWay<U64ToU64TableTrait, 4> eager;
+    TwoWay<U64ToU64TableTrait, 4, true> cuckoo;
+    eager.max_kicks = 0;
+
+    for (uint64_t i = 1; i <= 20000; i++) {
+        eager.insert(i, i + 1);
+        cuckoo.insert(i, i + 1);
+    }
+
+    EXPECT_LE(cuckoo.capacity, eager.capacity);
+    EXPECT_GT(cuckoo.load_factor(), 0.45);
+    EXPECT_EQ(cuckoo.size(), 20000u);
+    for (uint64_t i = 1; i <= 20000; i++) {
+        EXPECT_EQ(cuckoo.find(i), i + 1);
+    }
+    EXPECT_FALSE(cuckoo.contains(20001));
+}
+
+TEST(TwoWay, IncrementalGrowthKeepsKeysReachable) {
+    TwoWay<U64ToU64TableTrait, 4, true> map;
+    map.migrate_step = 1;
+    std::vector<bool> erased(5001, false);
+    uint64_t expected_sum = 0;
+    bool saw_migration = false;
+
+    for (uint64_t i = 1; i <= 5000; i++) {
+        map.insert(i, i * 7);
+        expected_sum += i * 7;
+        saw_migration |= static_cast<bool>(map.old_data);
+        if (i % 97 == 0) {
+            EXPECT_EQ(map.find(i / 2), (i / 2) * 7);
+            map.erase(i / 3);
+            erased[i / 3] = true;
+            expected_sum -= (i / 3) * 7;
+            EXPECT_FALSE(map.contains(i / 3));
+        }
+    }
+
+    EXPECT_TRUE(saw_migration);
+    EXPECT_EQ(map.sum_all_values(), expected_sum);
+    map.finish_migration();
+    EXPECT_FALSE(map.old_data);
+    EXPECT_EQ(map.sum_all_values(), expected_sum);
+    for (uint64_t i = 1; i <= 5000; i++) {
+        EXPECT_EQ(map.contains(i), !erased[i]);
+    }
+}
+
+TEST(TwoWay, FindPtrReportsMisses) {
+    TwoWay<U64ToU64TableTrait, 4> map;
+    TwoWay<U64ToU64TableTrait, 4, true> tagged;
+    tagged.migrate_step = 2;
+
+    for (uint64_t i = 1; i <= 3000; i++) {
+        map.insert(i, i + 5);
+        tagged.insert(i, i + 5);
+    }
+    for (uint64_t i = 1; i <= 6000; i++) {
+        const auto* value = map.find_ptr(i);
+        const auto* tagged_value = tagged.find_ptr(i);
+        if (i <= 3000) {
+            ASSERT_NE(value, nullptr);
+            ASSERT_NE(tagged_value, nullptr);
+            EXPECT_EQ(*value, i + 5);
+            EXPECT_EQ(*tagged_value, i + 5);
+        } else {
+            EXPECT_EQ(value, nullptr);
+            EXPECT_EQ(tagged_value, nullptr);
+        }
+    }
+
+    *map.find_ptr(7) = 70;
+    EXPECT_EQ(map.find(7), 70u);
+
+    std::vector<uint64_t> keys{1, 5000, 2};
+    std::vector<uint64_t> values(3, 99);
+    map.find_many(std::span<const uint64_t>{keys}, std::span<uint64_t>{values});
+    EXPECT_EQ(values, (std::vector<uint64_t>{6, 0, 7}));
+}
+
+struct CollidingTableTrait {
+    using Key = uint64_t;
+    using Value = uint64_t;
+
+    // Keys below 100 all share bucket 0 whatever the capacity.
+    static uint64_t hash(Key key) {
+        return key < 100 ? 0 : squirrel3(key);
+    }
+};
+
+TEST(TwoWay, StashAbsorbsSaturatedBucketPair) {
+    TwoWay<CollidingTableTrait, 4> map;
+
+    for (uint64_t i = 1; i <= 10; i++) {
+        map.insert(i, i * 2);
+    }
+    EXPECT_EQ(map.capacity, 8u);
+    EXPECT_EQ(map.stash_size, 6u);
+    EXPECT_EQ(map.size(), 10u);
+    for (uint64_t i = 1; i <= 10; i++) {
+        EXPECT_EQ(map.find(i), i * 2);
+    }
+    EXPECT_EQ(map.find_ptr(11), nullptr);
+
+    map.erase(9);
+    EXPECT_EQ(map.stash_size, 5u);
+    EXPECT_FALSE(map.contains(9));
+    EXPECT_EQ(map.find(10), 20u);
+
+    for (uint64_t i = 1000; i < 1100; i++) {
+        map.insert(i, i);
+    }
+    EXPECT_EQ(map.size(), 109u);
+    for (uint64_t i = 1000; i < 1100; i++) {
+        EXPECT_EQ(map.find(i), i);
+    }
+    EXPECT_EQ(map.find(10), 20u);
+}
+
+TEST(TwoWay, GrowsByFactorAndReservesExactly) {
+    TwoWay<U64ToU64TableTrait, 4> map;
+    map.growth = 1.5;
+    for (uint64_t i = 1; i <= 20'000; i++) {
+        map.insert(i, i + 1);
+    }
+    EXPECT_FALSE(std::has_single_bit(map.capacity));
+    for (uint64_t i = 1; i <= 20'000; i++) {
+        EXPECT_EQ(map.find(i), i + 1);
+    }
+
+    // 10000 / (0.9 * 4) rounded up.
+    TwoWay<U64ToU64TableTrait, 4> reserved;
+    reserved.reserve(10'000);
+    EXPECT_EQ(reserved.capacity, 2778u);
+    for (uint64_t i = 1; i <= 10'000; i++) {
+        reserved.insert(i, i);
+    }
+    EXPECT_EQ(reserved.capacity, 2778u);
+    EXPECT_EQ(reserved.size(), 10'000u);
+    for (uint64_t i = 1; i <= 10'000; i++) {
+        EXPECT_EQ(reserved.find(i), i);
+    }
+}
+
+TEST(TwoWay, RehashRetriesLargerWithoutLosingEntries) {
+    // Two-lane buckets without cuckoo moves overflow at low load, so most rehash passes at a 1%
+    // growth step fail and restart one step larger.
+    TwoWay<U64ToU64TableTrait, 2> map;
+    map.max_kicks = 0;
+    map.growth = 1.01;
+    for (uint64_t i = 1; i <= 2'000; i++) {
+        map.insert(i, i * 5);
+    }
+    EXPECT_EQ(map.size(), 2'000u);
+    for (uint64_t i = 1; i <= 2'000; i++) {
+        EXPECT_EQ(map.find(i), i * 5);
+    }
+    EXPECT_EQ(map.sum_all_values(), 5u * 2'000u * 2'001u / 2u);
+}
+
+TEST(TwoWay, IteratesEveryEntryOnce) {
+    // Keys below 100 collide, so some entries sit in the stash.
+    TwoWay<CollidingTableTrait, 4> map;
+    map.migrate_step = 1;
+    std::vector<uint64_t> keys{};
+    for (uint64_t i = 1; i <= 10; i++) {
+        keys.emplace_back(i);
+    }
+    for (uint64_t i = 1'000; i < 3'000; i++) {
+        keys.emplace_back(i);
+    }
+    for (const auto key : keys) {
+        map.insert(key, key * 2);
+    }
+    ASSERT_GT(map.stash_size, 0u);
+
+    uint64_t visited = 0;
+    uint64_t sum = 0;
+    map.for_each([&](const uint64_t& key, uint64_t& value) {
+        EXPECT_EQ(value, key * 2);
+        visited++;
+        sum += value;
+    });
+    EXPECT_EQ(visited, keys.size());
+    EXPECT_EQ(sum, map.sum_all_values());
+
+    std::vector<uint64_t> seen(3'000, 0);
+    for (auto [key, value] : map) {
+        seen[key]++;
+        value++;
+    }
+    for (const auto key : keys) {
+        EXPECT_EQ(seen[key], 1u);
+    }
+    EXPECT_EQ(map.sum_all_values(), sum + keys.size());
+}
+
+TEST(TwoWay, BulkConstructorSizesOnce) {
+    std::vector<std::pair<uint64_t, uint64_t>> entries{};
+    for (uint64_t i = 1; i <= 30'000; i++) {
+        entries.emplace_back(i, i * 3);
+    }
+    using Map = TwoWay<U64ToU64TableTrait, 8>;
+    Map map{std::span<const std::pair<uint64_t, uint64_t>>{entries}};
+
+    EXPECT_EQ(map.capacity, Map::buckets_for(entries.size()));
+    EXPECT_EQ(map.size(), entries.size());
+    for (const auto& [key, value] : entries) {
+        EXPECT_EQ(map.find(key), value);
+    }
+    EXPECT_FALSE(map.contains(30'001));
+}
+
+TEST(TwoWay, BulkConstructorHandlesFullBucketPairs) {
+    // Keys below 100 collide, so 1..10 overflow their bucket pair into the stash.
+    std::vector<std::pair<uint64_t, uint64_t>> entries{};
+    for (uint64_t i = 1; i <= 10; i++) {
+        entries.emplace_back(i, i * 7);
+    }
+    for (uint64_t i = 1'000; i < 3'000; i++) {
+        entries.emplace_back(i, i * 7);
+    }
+    TwoWay<CollidingTableTrait, 4> map{std::span<const std::pair<uint64_t, uint64_t>>{entries}};
+
+    EXPECT_GT(map.stash_size, 0u);
+    EXPECT_EQ(map.size(), entries.size());
+    for (const auto& [key, value] : entries) {
+        EXPECT_EQ(map.find(key), value);
+    }
+    EXPECT_FALSE(map.contains(11));
+}
+
+TEST(TwoWay, ConcurrentBuildPlacesEveryEntry) {
+    std::vector<std::pair<uint64_t, uint64_t>> entries{};
+    for (uint64_t i = 1; i <= 40'000; i++) {
+        entries.emplace_back(i, i * 9);
+    }
+    TwoWay<U64ToU64TableTrait, 4> map{entries.size() / 2};
+    const uint64_t capacity = map.capacity;
+    map.build(entries, 4);
+
+    EXPECT_EQ(map.size(), entries.size());
+    for (const auto& [key, value] : entries) {
+        EXPECT_EQ(map.find(key), value);
+    }
+    EXPECT_GE(map.capacity, capacity);
+}
+
+TEST(TwoWay, InsertConcurrentReportsFullBuckets) {
+    // Every key below 100 maps to bucket 0 twice, so only BUCKET of them fit.
+    TwoWay<CollidingTableTrait, 4> map;
+    EXPECT_TRUE(map.insert_concurrent(1, 10));
+    EXPECT_TRUE(map.insert_concurrent(2, 20));
+    EXPECT_TRUE(map.insert_concurrent(3, 30));
+    EXPECT_TRUE(map.insert_concurrent(4, 40));
+    EXPECT_FALSE(map.insert_concurrent(5, 50));
+    EXPECT_EQ(map.size(), 4u);
+    EXPECT_EQ(map.capacity, 8u);
+}
+
+template <typename Map>
+void expect_snapshot_round_trip(const char* path) {
+    Map map;
+    for (uint64_t i = 1; i <= 5'000; i++) {
+        map.insert(i, i * 7);
+    }
+    ASSERT_TRUE(map.save(path));
+
+    auto mapped = Map::open_mapped(path);
+    ASSERT_NE(mapped, nullptr);
+    EXPECT_EQ(mapped->size(), map.size());
+    EXPECT_EQ(mapped->capacity, map.capacity);
+    for (uint64_t i = 1; i <= 5'000; i++) {
+        EXPECT_EQ(mapped->find(i), i * 7);
+    }
+    EXPECT_FALSE(mapped->contains(5'001));
+    std::remove(path);
+}
+
+TEST(TwoWay, SnapshotRoundTrip) {
+    const auto path = std::filesystem::temp_directory_path() / "two_way_round_trip.snapshot";
+    expect_snapshot_round_trip<TwoWay<U64ToU64TableTrait>>(path.c_str());
+    expect_snapshot_round_trip<TwoWay<U64ToU64TableTrait, 4, true>>(path.c_str());
+    expect_snapshot_round_trip<TwoWay<U64ToU64TableTrait, 4, false, layout::Interleaved>>(
+        path.c_str());
+    expect_snapshot_round_trip<TwoWay<U64ToU64TableTrait, 4, false, layout::Separate>>(
+        path.c_str());
+}
+
+TEST(TwoWay, SnapshotRejectsMismatchAndCorruption) {
+    const auto path = std::filesystem::temp_directory_path() / "two_way_reject.snapshot";
+    TwoWay<CollidingTableTrait, 4> map;
+    for (uint64_t i = 1; i <= 10; i++) {
+        map.insert(i, i);
+    }
+    ASSERT_TRUE(map.save(path.c_str()));
+    EXPECT_NE((TwoWay<CollidingTableTrait, 4>::open_mapped(path.c_str())), nullptr);
+    EXPECT_EQ((TwoWay<U64ToU64TableTrait, 4>::open_mapped(path.c_str())), nullptr);
+    EXPECT_EQ((TwoWay<CollidingTableTrait, 8>::open_mapped(path.c_str())), nullptr);
+
+    // Flip one byte of the bucket storage.
+    {
+        std::fstream file{path, std::ios::in | std::ios::out | std::ios::binary};
+        file.seekp(snapshot::HEADER_BYTES + 100);
+        file.put('\x5A');
+    }
+    EXPECT_EQ((TwoWay<CollidingTableTrait, 4>::open_mapped(path.c_str())), nullptr);
+    EXPECT_NE((TwoWay<CollidingTableTrait, 4>::open_mapped(path.c_str(), false)), nullptr);
+    std::remove(path.c_str());
+}
+
+TEST(TwoWay, SnapshotSaveReplacesMappedFile) {
+    const auto path = std::filesystem::temp_directory_path() / "two_way_replace.snapshot";
+    using Map = TwoWay<U64ToU64TableTrait, 4>;
+    Map before;
+    Map after;
+    for (uint64_t i = 1; i <= 5'000; i++) {
+        before.insert(i, i);
+        after.insert(i, i * 2);
+    }
+    ASSERT_TRUE(before.save(path.c_str()));
+    auto mapped = Map::open_mapped(path.c_str());
+    ASSERT_NE(mapped, nullptr);
+
+    // Saving over a mapped snapshot leaves the old mapping readable.
+    ASSERT_TRUE(after.save(path.c_str()));
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    for (uint64_t i = 1; i <= 5'000; i++) {
+        EXPECT_EQ(mapped->find(i), i);
+    }
+    auto replaced = Map::open_mapped(path.c_str());
+    ASSERT_NE(replaced, nullptr);
+    EXPECT_EQ(replaced->find(7), 14u);
+
+    // A failed save leaves no file behind.
+    const auto missing = std::filesystem::temp_directory_path() / "two_way_missing" / "x";
+    EXPECT_FALSE(after.save(missing.c_str()));
+    std::remove(path.c_str());
+}
+
+TEST(TwoWay, SnapshotOfEqualTablesIsByteIdentical) {
+    // Free lanes are zeroed before saving, so two tables built the same way give the same file.
+    const auto path = std::filesystem::temp_directory_path() / "two_way_identical.snapshot";
+    auto saved = [&](uint64_t garbage) {
+        {
+            // Leave recognisable bytes in freed heap memory for the next table to pick up.
+            std::vector<uint64_t> noise(1 << 16, garbage);
+        }
+        TwoWay<U64ToU64TableTrait, 4, true> map;
+        for (uint64_t i = 1; i <= 3'000; i++) {
+            map.insert(i, i);
+        }
+        EXPECT_TRUE(map.save(path.c_str()));
+        std::ifstream file{path, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{file}, {}};
+    };
+    const auto first = saved(0x1111111111111111ULL);
+    const auto second = saved(0x2222222222222222ULL);
+    EXPECT_EQ(first, second);
+    std::remove(path.c_str());
+}
+
+TEST(TwoWay, ProbeStatsRecordWhereLookupsEnd) {
+    static_assert(std::is_empty_v<stats::Off>);
+    TwoWay<CollidingTableTrait, 4, false, layout::Split, stats::Probes> map;
+    // Keys 1..10 share one bucket, so the last six end up in the stash.
+    for (uint64_t i = 1; i <= 10; i++) {
+        map.insert(i, i);
+    }
+    for (uint64_t i = 1'000; i < 2'000; i++) {
+        map.insert(i, i);
+    }
+    map.probe_stats.clear();
+
+    for (uint64_t i = 1; i <= 10; i++) {
+        EXPECT_EQ(map.find(i), i);
+    }
+    for (uint64_t i = 1'000; i < 2'000; i++) {
+        EXPECT_EQ(map.find(i), i);
+    }
+    for (uint64_t i = 5'000; i < 5'100; i++) {
+        EXPECT_FALSE(map.contains(i));
+    }
+
+    const auto& probes = map.probe_stats;
+    EXPECT_EQ(probes.hits(), 1'010u);
+    EXPECT_EQ(probes.misses, 100u);
+    EXPECT_EQ(probes.choices[stats::STASH], 6u);
+    EXPECT_GT(probes.choices[stats::FIRST], probes.choices[stats::SECOND]);
+    uint64_t lanes = 0;
+    uint64_t lengths = 0;
+    for (const auto count : probes.lanes) {
+        lanes += count;
+    }
+    for (const auto count : probes.lengths) {
+        lengths += count;
+    }
+    EXPECT_EQ(lanes, probes.hits());
+    EXPECT_EQ(lengths, probes.hits());
+    // Stash hits come after both full buckets.
+    EXPECT_EQ(probes.length_quantile(1.0), 2 * 4 + 5u);
+}
+
+TEST(TwoWay, StatsDescribeOccupancy) {
+    TwoWay<CollidingTableTrait, 4, false, layout::Split, stats::Probes> map;
+    map.migrate_step = 1;
+    for (uint64_t i = 1; i <= 10; i++) {
+        map.insert(i, i);
+    }
+    for (uint64_t i = 1'000; i < 3'000; i++) {
+        map.insert(i, i);
+    }
+
+    const auto occupancy = map.stats();
+    EXPECT_EQ(occupancy.size, map.size());
+    EXPECT_EQ(occupancy.buckets, map.capacity);
+    EXPECT_DOUBLE_EQ(occupancy.load_factor, map.load_factor());
+    EXPECT_EQ(occupancy.stashed, 6u);
+    ASSERT_EQ(occupancy.fill.size(), 5u);
+    uint64_t buckets = 0;
+    uint64_t entries = 0;
+    for (uint64_t k = 0; k < occupancy.fill.size(); k++) {
+        buckets += occupancy.fill[k];
+        entries += k * occupancy.fill[k];
+    }
+    EXPECT_EQ(buckets, map.capacity);
+    EXPECT_EQ(entries + occupancy.stashed, map.size());
+    EXPECT_GT(occupancy.miss_cost, occupancy.stashed);
+
+    // Looking every entry up once sees exactly what stats() predicts.
+    map.probe_stats.clear();
+    map.for_each([&](uint64_t key, uint64_t) { EXPECT_TRUE(map.contains(key)); });
+    const auto& probes = map.probe_stats;
+    EXPECT_DOUBLE_EQ(occupancy.hit_cost, probes.mean_length());
+    EXPECT_DOUBLE_EQ(
+        occupancy.second_fraction,
+        static_cast<double>(probes.choices[stats::SECOND]) / static_cast<double>(map.size()));
+}
+
+TEST(TwoWay, UpsertOverloads) {
+    TwoWay<U64ToU64TableTrait, 4> map;
+    auto [value, inserted] = map.try_emplace(7, 70);
+    EXPECT_TRUE(inserted);
+    EXPECT_EQ(*value, 70u);
+    std::tie(value, inserted) = map.try_emplace(7, 71);
+    EXPECT_FALSE(inserted);
+    EXPECT_EQ(*value, 70u);
+
+    EXPECT_FALSE(map.insert_or_assign(7, 72));
+    EXPECT_EQ(map.find(7), 72u);
+    EXPECT_TRUE(map.insert_or_assign(8, 80));
+    EXPECT_EQ(map.find(8), 80u);
+
+    map.find_or_insert(9, 90) += 1;
+    map.find_or_insert(9, 0) += 1;
+    EXPECT_EQ(map.find(9), 92u);
+    map[10] = 100;
+    map[10]++;
+    EXPECT_EQ(map.find(10), 101u);
+
+    EXPECT_TRUE(map.update(11, [](uint64_t& v) { v = 5; }));
+    EXPECT_FALSE(map.update(11, [](uint64_t& v) { v *= 3; }));
+    EXPECT_EQ(map.find(11), 15u);
+    EXPECT_EQ(map.size(), 5u);
+}
+
+struct CountingTableTrait {
+    using Key = uint64_t;
+    using Value = uint64_t;
+
+    static inline uint64_t calls = 0;
+    static uint64_t hash(Key key) {
+        calls++;
+        return squirrel3(key);
+    }
+};
+
+TEST(TwoWay, UpsertHashesOnce) {
+    TwoWay<CountingTableTrait, 8> map;
+    map.reserve(4'000);
+    CountingTableTrait::calls = 0;
+    for (uint64_t round = 0; round < 3; round++) {
+        for (uint64_t key = 1; key <= 1'000; key++) {
+            map.update(key, [](uint64_t& count) { count++; });
+        }
+    }
+    EXPECT_EQ(CountingTableTrait::calls, 3'000u);
+    EXPECT_EQ(map.size(), 1'000u);
+    EXPECT_EQ(map.sum_all_values(), 3'000u);
+}
+
+TEST(TwoWay, UpsertCountsLikeUnorderedMap) {
+    for (const uint64_t step : {uint64_t{0}, uint64_t{1}}) {
+        TwoWay<CollidingTableTrait, 4> map;
+        map.migrate_step = step;
+        std::unordered_map<uint64_t, uint64_t> expected;
+        uint64_t rng = 0x1234;
+        // Keys 1..8 collide into the stash, the rest grow the table repeatedly.
+        for (uint64_t i = 0; i < 20'000; i++) {
+            rng = squirrel3(rng);
+            const uint64_t key = i % 5 == 0 ? 1 + rng % 8 : 100 + rng % 4'000;
+            map.update(key, [](uint64_t& count) { count++; });
+            expected[key]++;
+        }
+        EXPECT_EQ(map.size(), expected.size());
+        for (const auto& [key, count] : expected) {
+            EXPECT_EQ(map.find(key), count);
+        }
+    }
+}
+
+struct U64SetTrait {
+    using Key = uint64_t;
+
+    static uint64_t hash(Key key) {
+        return squirrel3(key);
+    }
+};
+
+TEST(TwoWay, SetStoresOnlyKeys) {
+    using Set = TwoWaySet<U64SetTrait>;
+    static_assert(Set::BUCKET_LANES == CACHE_LINE / 8);
+    static_assert(Set::Buckets::BYTES_PER_BUCKET == CACHE_LINE);
+    static_assert(std::is_same_v<TwoWaySet<U64ToU64TableTrait>::Value, NoValue>);
+
+    Set set;
+    TwoWay<U64ToU64TableTrait> map;
+    for (uint64_t i = 1; i <= 20000; i++) {
+        set.insert(i * 3);
+        map.insert(i * 3, i);
+    }
+    EXPECT_EQ(set.size(), 20000u);
+    for (uint64_t i = 1; i <= 60000; i++) {
+        EXPECT_EQ(set.contains(i), i % 3 == 0) << i;
+    }
+    EXPECT_LT(set.memory_usage() * 3, map.memory_usage() * 2);
+
+    EXPECT_FALSE(set.try_insert(3));
+    EXPECT_TRUE(set.try_insert(4));
+    set.erase(3);
+    EXPECT_FALSE(set.contains(3));
+    EXPECT_TRUE(set.contains(4));
+
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    set.for_each([&](uint64_t key) {
+        count++;
+        sum += key;
+    });
+    EXPECT_EQ(count, set.size());
+    EXPECT_EQ(sum, 3 * 20000 * 20001 / 2 - 3 + 4);
+
+    const auto path = std::filesystem::temp_directory_path() / "two_way_set.snapshot";
+    ASSERT_TRUE(set.save(path.c_str()));
+    auto mapped = Set::open_mapped(path.c_str());
+    ASSERT_NE(mapped, nullptr);
+    EXPECT_EQ(mapped->size(), set.size());
+    EXPECT_TRUE(mapped->contains(4));
+    EXPECT_TRUE(mapped->contains(60000));
+    EXPECT_FALSE(mapped->contains(3));
+    EXPECT_EQ((TwoWay<U64ToU64TableTrait>::open_mapped(path.c_str())), nullptr);
+    std::remove(path.c_str());
+}
+
+TEST(TwoWay, SetBulkConstructorAndStash) {
+    std::vector<uint64_t> keys{};
+    for (uint64_t i = 1; i <= 5000; i++) {
+        keys.push_back(i * 7919);
+    }
+    TwoWaySet<U64SetTrait, 4, true> set{std::span<const uint64_t>{keys}};
+    EXPECT_EQ(set.size(), keys.size());
+    for (const auto key : keys) {
+        EXPECT_TRUE(set.contains(key));
+        EXPECT_FALSE(set.contains(key + 1));
+    }
+
+    // Every key lands in the same two buckets, so most of them end up in the stash.
+    TwoWaySet<CollidingTableTrait, 4> colliding;
+    colliding.max_kicks = 0;
+    for (uint64_t i = 0; i < 12; i++) {
+        colliding.insert(i);
+    }
+    EXPECT_EQ(colliding.stash_size, 8u);
+    for (uint64_t i = 0; i < 12; i++) {
+        EXPECT_TRUE(colliding.contains(i));
+    }
+    EXPECT_FALSE(colliding.contains(12));
 }